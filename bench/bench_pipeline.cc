@@ -0,0 +1,343 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Whole pipeline benchmark: the real plugin, fed by the libobs stand-in
+// in tools/harness, delivering to tools/consumer in another process.
+//
+// Build (POSIX), e.g.
+//   cc -O2 -c src/yuv420_yuyv.c src/scale_yuyv.c src/audio_pack.c src/resample.c
+//   c++ -O2 -std=c++17 -DDROIDCAM_OVERRIDE=1 -Itools/harness/libobs -Itools/harness
+//       -o bench_pipeline bench/bench_pipeline.cc tools/harness/obs-harness.cc
+//       src/plugin.cc src/latency.cc src/workers.cc src/sys-posix.cc *.o -lpthread
+//
+// Usage: start the consumer, then the benchmark on the same instance
+//   consumer -i 1 -s 1280x720 -r 30 -t 0 &
+//   bench_pipeline -i 1 [options]
+//
+//   -i n       output instance (0)
+//   -s WxH     OBS canvas size (1920x1080)
+//   -r fps     OBS frame rate (30), 0 = feed frames back to back
+//   -F format  what OBS renders, nv12 or i420 (nv12)
+//   -a rate    OBS sample rate (48000)
+//   -n ch      OBS channels (2)
+//   -t sec     run time (10)
+//   -R sec     every sec seconds, switch the webcam size in the header
+//              to -S and back, as a driver would (0 = never)
+//   -S WxH     size to switch to (640x480)
+//   -L         large, locked pages for the shared memory
+//   -o key=n   integer output setting, e.g. -o audio_cpu=2 -o audio_priority=50
+//              (repeatable, thread placement shows in the -v log)
+//   -v         show the plugin log
+//
+// Frames out and size switch times come from the frame slots, so the
+// consumer has to use them (its default, -b 3). Free running, frame
+// timestamps are still 1/fps apart, and latency seen by the consumer
+// means nothing.
+//
+// Reports, per second and in total: video callbacks/s and frames
+// published to the consumer, time spent in raw_video / raw_audio,
+// capture restarts with the time capture was stopped for, and for each
+// size switch the time until the first frame of the new size is out.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "harness.h"
+#include "../src/structs.h"
+#include "../src/transport.h"
+
+bool obs_module_load(void);
+void obs_module_unload(void);
+
+struct duration_log {
+    std::mutex lock;
+    std::vector<uint64_t> ns;
+    size_t reported = 0;
+};
+
+static duration_log callbacks[2];  // HARNESS_VIDEO, HARNESS_AUDIO
+static duration_log capture_gaps;
+static std::atomic<uint64_t> stopped_at{0};
+
+static void on_callback_done(void *param, int kind, uint64_t start_ns, uint64_t end_ns) {
+    (void) param;
+    std::lock_guard<std::mutex> guard(callbacks[kind].lock);
+    callbacks[kind].ns.push_back(end_ns - start_ns);
+}
+
+static void on_capture_changed(void *param, bool active, uint64_t ns) {
+    (void) param;
+    if (!active) {
+        stopped_at = ns;
+        return;
+    }
+
+    const uint64_t since = stopped_at.exchange(0);
+    if (since) {
+        std::lock_guard<std::mutex> guard(capture_gaps.lock);
+        capture_gaps.ns.push_back(ns - since);
+    }
+}
+
+struct summary {
+    size_t count;
+    double p50, p90, p99, max; // us
+};
+
+// Entries since the last call with `window`, or all of them
+static summary summarize(duration_log *log, bool window) {
+    std::vector<uint64_t> v;
+    {
+        std::lock_guard<std::mutex> guard(log->lock);
+        v.assign(log->ns.begin() + (window ? log->reported : 0), log->ns.end());
+        if (window)
+            log->reported = log->ns.size();
+    }
+
+    summary s = {};
+    s.count = v.size();
+    if (v.empty())
+        return s;
+
+    std::sort(v.begin(), v.end());
+    auto pct = [&v](size_t p) { return v[(v.size() - 1) * p / 100] / 1e3; };
+    s.p50 = pct(50);
+    s.p90 = pct(90);
+    s.p99 = pct(99);
+    s.max = pct(100);
+    return s;
+}
+
+static void print_summary(const char *what, const summary &s) {
+    printf("%-18s %8zu %10.1f %10.1f %10.1f %10.1f\n",
+        what, s.count, s.p50, s.p90, s.p99, s.max);
+}
+
+// Write a new webcam size the way a driver does and time how long until
+// the plugin publishes a frame of it: it drops `latest` to -1 when it
+// switches, hot or with a capture restart, and sets it again with the
+// first new frame. Returns -1 if that was not seen, which is always the
+// case with the single buffer protocol.
+static double reconfigure(VideoHeader *vh, SharedEvent *control, int width, int height) {
+    vh->info.width = width;
+    vh->info.height = height;
+    vh->info.checksum = vh->info.interval ^ width ^ height;
+
+    const uint64_t start = os_gettime_ns();
+    const long seq = os_atomic_load_long(&vh->ring.seq);
+    bool cleared = false;
+    SetSharedEvent(control);
+    if (os_atomic_load_long(&vh->ring.frame_slots) != VIDEO_FRAME_SLOTS)
+        return -1;
+
+    while (os_gettime_ns() - start < 2000000000ULL) {
+        if (os_atomic_load_long(&vh->ring.latest) < 0)
+            cleared = true;
+        else if (cleared)
+            return (os_gettime_ns() - start) / 1e3;
+        else if (os_atomic_load_long(&vh->ring.seq) > seq + 2)
+            break; // missed the switch
+
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+
+    return -1;
+}
+
+static bool parse_size(const char *s, uint32_t *w, uint32_t *h) {
+    return sscanf(s, "%ux%u", w, h) == 2 && *w > 0 && *h > 0
+        && *w <= MAX_WIDTH && *h <= MAX_HEIGHT;
+}
+
+int main(int argc, char **argv) {
+    harness_config config = {};
+    config.width = 1920;
+    config.height = 1080;
+    config.format = VIDEO_FORMAT_NV12;
+    config.fps_num = 30;
+    config.fps_den = 1;
+    config.sample_rate = 48000;
+    config.channels = 2;
+    config.log_level = LOG_WARNING;
+    config.callback_done = on_callback_done;
+    config.capture_changed = on_capture_changed;
+
+    int instance = 0, seconds = 10, reconfig_sec = 0;
+    bool large_pages = false;
+    const char *int_settings[16];
+    int int_setting_count = 0;
+    uint32_t switch_w = 640, switch_h = 480;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : "";
+        if (!strcmp(a, "-v")) { config.log_level = LOG_DEBUG; continue; }
+        if (!strcmp(a, "-L")) { large_pages = true; continue; }
+
+        bool ok = true;
+        if      (!strcmp(a, "-i")) instance = atoi(v);
+        else if (!strcmp(a, "-s")) ok = parse_size(v, &config.width, &config.height);
+        else if (!strcmp(a, "-r")) config.fps_num = (uint32_t) atoi(v);
+        else if (!strcmp(a, "-F")) config.format = !strcmp(v, "i420") ? VIDEO_FORMAT_I420 : VIDEO_FORMAT_NV12;
+        else if (!strcmp(a, "-a")) config.sample_rate = (uint32_t) atoi(v);
+        else if (!strcmp(a, "-n")) config.channels = atoi(v);
+        else if (!strcmp(a, "-t")) seconds = atoi(v);
+        else if (!strcmp(a, "-R")) reconfig_sec = atoi(v);
+        else if (!strcmp(a, "-S")) ok = parse_size(v, &switch_w, &switch_h);
+        else if (!strcmp(a, "-o")) {
+            ok = strchr(v, '=') && int_setting_count < (int) (sizeof(int_settings) / sizeof(int_settings[0]));
+            if (ok) int_settings[int_setting_count++] = v;
+        }
+        else ok = false;
+
+        if (!ok || instance < 0 || instance >= MAX_INSTANCES) {
+            fprintf(stderr, "bad arguments, see the top of bench/bench_pipeline.cc\n");
+            return 1;
+        }
+        i++;
+    }
+
+    // the plugin still needs a frame rate to pace by
+    if (config.fps_num == 0) {
+        config.fps_num = 60;
+        config.free_run = true;
+    }
+
+    harness_init(&config);
+    obs_module_load();
+
+    obs_data_t *settings = obs_data_create();
+    obs_data_set_int(settings, "instance", instance);
+    obs_data_set_bool(settings, "large_pages", large_pages);
+    for (int i = 0; i < int_setting_count; i++) {
+        const char *eq = strchr(int_settings[i], '=');
+        std::string key(int_settings[i], eq - int_settings[i]);
+        obs_data_set_int(settings, key.c_str(), atoll(eq + 1));
+    }
+    obs_output_t *output = obs_output_create("droidcam_virtual_output", "bench", settings, NULL);
+    obs_data_release(settings);
+    if (!output)
+        return 1;
+
+    obs_output_set_media(output, obs_get_video(), obs_get_audio());
+    if (!obs_output_start(output)) {
+        fprintf(stderr, "output failed to start\n");
+        obs_output_release(output);
+        return 1;
+    }
+
+    // The same mapping the plugin and the consumer use
+    char name[64], event_name[64];
+    SharedMem video_mem = {};
+    SharedEvent control = {};
+    snprintf(name, sizeof(name), instance ? "%s_%d" : "%s", VIDEO_MAP_NAME, instance);
+    snprintf(event_name, sizeof(event_name), instance ? "%s_%d" : "%s", CONTROL_EVENT_NAME, instance);
+    if (!CreateSharedMem(&video_mem, name, VIDEO_MAP_SIZE)
+        || !CreateSharedEvent(&control, event_name, false, false))
+        return 1;
+
+    VideoHeader *vh = (VideoHeader *) video_mem.mem;
+    for (int i = 0; i < 30 && vh->info.control != CONTROL; i++)
+        os_sleep_ms(100);
+    if (vh->info.control != CONTROL) {
+        fprintf(stderr, "no consumer on instance %d, start tools/consumer -i %d first\n",
+            instance, instance);
+        obs_output_release(output);
+        CloseSharedEvent(&control);
+        CloseSharedMem(&video_mem);
+        return 1;
+    }
+
+    const int webcam_w = vh->info.width, webcam_h = vh->info.height;
+    printf("canvas %ux%u %s %s, webcam %dx%d, audio %u Hz %d ch\n",
+        config.width, config.height, config.format == VIDEO_FORMAT_NV12 ? "nv12" : "i420",
+        config.free_run ? "free running" : "paced", webcam_w, webcam_h,
+        config.sample_rate, config.channels);
+    if (os_atomic_load_long(&vh->ring.frame_slots) != VIDEO_FRAME_SLOTS)
+        printf("the consumer reads a single buffer, frames out and size switches are not counted\n");
+
+    std::vector<uint64_t> switches_us;
+    int switches_missed = 0;
+    bool switched = false;
+    long last_seq = os_atomic_load_long(&vh->ring.seq);
+    long published = 0;
+
+    printf("%4s %8s %9s %9s %9s %8s %9s %9s %8s\n", "sec", "video/s", "out/s",
+        "video p50", "video p99", "audio/s", "audio p50", "audio p99", "restarts");
+    for (int s = 1; s <= seconds; s++) {
+        os_sleep_ms(1000);
+
+        const long seq = os_atomic_load_long(&vh->ring.seq);
+        const long out = seq - last_seq;
+        published += out;
+        last_seq = seq;
+
+        const summary video = summarize(&callbacks[HARNESS_VIDEO], true);
+        const summary audio = summarize(&callbacks[HARNESS_AUDIO], true);
+        const summary gaps = summarize(&capture_gaps, true);
+        printf("%4d %8zu %9ld %9.1f %9.1f %8zu %9.1f %9.1f %8zu\n", s,
+            video.count, out, video.p50, video.p99,
+            audio.count, audio.p50, audio.p99, gaps.count);
+        fflush(stdout);
+
+        if (reconfig_sec > 0 && s % reconfig_sec == 0 && s < seconds) {
+            switched = !switched;
+            const double us = switched
+                ? reconfigure(vh, &control, switch_w, switch_h)
+                : reconfigure(vh, &control, webcam_w, webcam_h);
+            if (us < 0)
+                switches_missed++;
+            else
+                switches_us.push_back((uint64_t) (us * 1e3));
+            last_seq = os_atomic_load_long(&vh->ring.seq);
+        }
+    }
+
+    if (switched)
+        reconfigure(vh, &control, webcam_w, webcam_h);
+
+    obs_output_force_stop(output);
+    obs_output_release(output);
+    obs_module_unload();
+
+    printf("\n%-18s %8s %10s %10s %10s %10s\n", "us", "count", "p50", "p90", "p99", "max");
+    print_summary("raw_video", summarize(&callbacks[HARNESS_VIDEO], false));
+    print_summary("raw_audio", summarize(&callbacks[HARNESS_AUDIO], false));
+    print_summary("capture stopped", summarize(&capture_gaps, false));
+
+    duration_log switch_log;
+    switch_log.ns = switches_us;
+    print_summary("size switch", summarize(&switch_log, false));
+    if (switches_missed)
+        printf("size switches not timed: %d\n", switches_missed);
+
+    printf("published %.1f frames/s to the consumer\n", (double) published / seconds);
+
+    CloseSharedEvent(&control);
+    CloseSharedMem(&video_mem);
+    return 0;
+}
@@ -0,0 +1,760 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Standalone benchmark for the conversion kernels in src/yuv420_yuyv.c
+//
+// Build with the same flags as the plugin, e.g.
+//   cc -O2 -o bench_yuyv bench/bench_yuyv.c src/yuv420_yuyv.c src/scale_yuyv.c
+//   cl /O2 bench\bench_yuyv.c src\yuv420_yuyv.c src\scale_yuyv.c
+//
+// Usage: bench_yuyv [-t ms-per-case] [-c] [filter]
+//   -c only runs the correctness check
+//   filter is matched against the case name, eg. "2160p", "nv12", "uyvy",
+//   "copy", "clear", "borders", "scale" or "crossover"
+//
+// Before timing anything, every kernel level is checked against the
+// scalar kernels (see check_kernels), and the benchmark exits with 1 on
+// any mismatch.
+//
+// The map and scale cases run once per kernel the cpu supports (avx512bw,
+// avx2, sse2/neon, scalar). The "unaligned" widths exercise the row tails.
+// Scale cases convert straight from the source size, the bytes reported
+// are source planes read plus yuyv written.
+//
+// The crossover cases convert nv12 with cached and with streaming stores,
+// then read the frame back the way the consumer would. Streaming starts
+// to win about where the frame no longer fits in the last level cache,
+// compare that with the threshold printed. The read runs on the same
+// core here, while the real consumer is another process that only
+// shares the last level cache.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HAVE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "../src/scale_yuyv.h"
+#include "../src/structs.h"
+#include "../src/yuv420_yuyv.h"
+
+struct bench_case {
+    const char *name;
+    int width, height;           // converted area
+    int dest_width, dest_height; // webcam size
+    int shift_x, shift_y;
+};
+
+static const struct bench_case cases[] = {
+    { "720p",              1280,  720, 1280,  720,   0,   0 },
+    { "720p-unaligned",    1278,  720, 1278,  720,   0,   0 },
+    { "720p-pillarbox",     960,  720, 1280,  720, 160,   0 },
+    { "720p-odd-shift",     954,  720, 1280,  720, 163,   0 },
+    { "1080p",             1920, 1080, 1920, 1080,   0,   0 },
+    { "1080p-unaligned",   1918, 1080, 1918, 1080,   0,   0 },
+    { "1080p-pillarbox",   1440, 1080, 1920, 1080, 240,   0 },
+    { "1080p-letterbox",   1920,  800, 1920, 1080,   0, 140 },
+    { "1080p-odd-shift",   1434, 1080, 1920, 1080, 243,   0 },
+    { "1440p",             2560, 1440, 2560, 1440,   0,   0 },
+    { "1440p-unaligned",   2558, 1440, 2558, 1440,   0,   0 },
+    { "1440p-pillarbox",   1920, 1440, 2560, 1440, 320,   0 },
+    { "2160p",             3840, 2160, 3840, 2160,   0,   0 },
+    { "2160p-unaligned",   3838, 2160, 3838, 2160,   0,   0 },
+    { "2160p-pillarbox",   2880, 2160, 3840, 2160, 480,   0 },
+    { "2160p-letterbox",   3840, 1600, 3840, 2160,   0, 280 },
+};
+
+struct scale_case {
+    const char *name;
+    int src_width, src_height;   // obs output
+    int width, height;           // scaled image
+    int dest_width, dest_height; // webcam size
+    int shift_x, shift_y;
+};
+
+static const struct scale_case scale_cases[] = {
+    { "scale-2160p-1080p-2:1",  3840, 2160, 1920, 1080, 1920, 1080,   0,   0 },
+    { "scale-1080p-720p-3:2",   1920, 1080, 1280,  720, 1280,  720,   0,   0 },
+    { "scale-1440p-1080p-4:3",  2560, 1440, 1920, 1080, 1920, 1080,   0,   0 },
+    { "scale-720p-540p-4:3",    1280,  720,  960,  540,  960,  540,   0,   0 },
+    { "scale-1080p-480p-pillar",1920, 1080,  852,  480,  854,  480,   0,   0 },
+    { "scale-720p-1080p-up",    1280,  720, 1920, 1080, 1920, 1080,   0,   0 },
+    { "scale-1080p-600p-bilin", 1920, 1080, 1066,  600, 1066,  600,   0,   0 },
+};
+
+// Output sizes for the cached / streaming store comparison
+static const struct { int width, height; } crossover_sizes[] = {
+    {  640,  360 }, {  960,  540 }, { 1280,  720 }, { 1600,  900 },
+    { 1920, 1080 }, { 2560, 1440 }, { 3200, 1800 }, { 3840, 2160 },
+};
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof(a[0]))
+
+// One load per cache line, what it costs the consumer to get the frame
+static uint64_t read_frame(const uint8_t *src, size_t bytes) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < bytes; i += 64)
+        sum += *(const uint64_t *)(src + i);
+    return sum;
+}
+
+static uint64_t now_ns(void) {
+    #ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    #endif
+}
+
+static uint64_t now_cycles(void) {
+    #if HAVE_TSC
+    return __rdtsc();
+    #else
+    return 0;
+    #endif
+}
+
+static void *alloc_aligned(size_t size) {
+    #ifdef _WIN32
+    return _aligned_malloc(size, 64);
+    #else
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, 64, size) != 0) return NULL;
+    return ptr;
+    #endif
+}
+
+static void free_aligned(void *ptr) {
+    #ifdef _WIN32
+    _aligned_free(ptr);
+    #else
+    free(ptr);
+    #endif
+}
+
+struct result {
+    double ns_per_frame;
+    double cycles_per_frame;
+    int frames;
+};
+
+// Run fn until budget_ms has passed, after one warm-up call.
+#define RUN_TIMED(budget_ms, res, call) do { \
+    call; \
+    uint64_t t0 = now_ns(), c0 = now_cycles(), t1; \
+    int n = 0; \
+    do { call; n++; t1 = now_ns(); } \
+    while (t1 - t0 < (uint64_t)(budget_ms) * 1000000ULL); \
+    (res).cycles_per_frame = (double)(now_cycles() - c0) / n; \
+    (res).ns_per_frame = (double)(t1 - t0) / n; \
+    (res).frames = n; \
+} while (0)
+
+static void print_result(const char *name, const char *variant,
+    const struct result *r, double bytes, double pixels)
+{
+    double gbs = bytes / r->ns_per_frame;
+    printf("%-24s %-8s %12.0f %8.2f", name, variant, r->ns_per_frame, gbs);
+    if (HAVE_TSC)
+        printf(" %10.3f", r->cycles_per_frame / pixels);
+    else
+        printf(" %10s", "-");
+    printf(" %8d\n", r->frames);
+}
+
+// Correctness: each level against scalar, same arguments, over odd
+// widths, shifts, letterboxing, banded conversion and both store kinds.
+// Source samples stay within 16..235 and dst starts out as CHECK_CANARY,
+// so a pixel that nothing wrote, or a write past the frame, shows up too.
+
+#define CHECK_CANARY 0xFF
+#define CHECK_GUARD  256        // canary bytes checked after the frame
+#define CHECK_COLOR  0x80108010 // border fill, never CHECK_CANARY
+
+enum check_kind {
+    CHECK_I420_YUYV = 0,
+    CHECK_I420_UYVY,
+    CHECK_NV12_YUYV,
+    CHECK_NV12_UYVY,
+    CHECK_KINDS,
+};
+
+static const char *const check_kind_names[CHECK_KINDS] = {
+    "i420-yuyv", "i420-uyvy", "nv12-yuyv", "nv12-uyvy",
+};
+
+struct check_shape {
+    int src_width, src_height;   // scaler input, 0 = no scaling
+    int width, height;           // converted (scaled) image
+    int dest_width, dest_height;
+    int shift_x, shift_y;
+};
+
+struct check_src {
+    uint8_t *i420[3];
+    uint8_t *nv12[2];
+    uint32_t linesize_i420[3];
+    uint32_t linesize_nv12[2];
+};
+
+static void check_fill_src(struct check_src *src, int width, int height) {
+    src->linesize_i420[0] = (width + 31) & ~31;
+    src->linesize_i420[1] = ((width / 2) + 31) & ~31;
+    src->linesize_i420[2] = src->linesize_i420[1];
+    src->linesize_nv12[0] = src->linesize_i420[0];
+    src->linesize_nv12[1] = src->linesize_i420[0];
+
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            src->i420[0][y * src->linesize_i420[0] + x] = (uint8_t)(16 + (x * 7 + y * 13) % 220);
+
+    for (int y = 0; y < height / 2; y++) {
+        for (int x = 0; x < width / 2; x++) {
+            uint8_t u = (uint8_t)(16 + (x * 3 + y * 5) % 220);
+            uint8_t v = (uint8_t)(16 + (x * 11 + y * 2) % 220);
+            src->i420[1][y * src->linesize_i420[1] + x] = u;
+            src->i420[2][y * src->linesize_i420[2] + x] = v;
+            src->nv12[1][y * src->linesize_nv12[1] + (x<<1)]     = u;
+            src->nv12[1][y * src->linesize_nv12[1] + (x<<1) + 1] = v;
+        }
+    }
+}
+
+// Borders, then the image in `bands` bands split like the plugin does
+static void check_render(uint8_t *out, int kind, const struct yuyv_scaler *scaler,
+    struct check_src *src, const struct check_shape *c, int bands)
+{
+    const size_t frame = (size_t) c->dest_width * c->dest_height * 2;
+    memset(out, CHECK_CANARY, frame + CHECK_GUARD);
+    clear_yuyv_borders(out, c->dest_width, c->dest_height,
+        c->shift_x, c->shift_y, c->width, c->height, CHECK_COLOR);
+
+    const int nv12 = kind == CHECK_NV12_YUYV || kind == CHECK_NV12_UYVY;
+    const int uyvy = kind == CHECK_I420_UYVY || kind == CHECK_NV12_UYVY;
+    uint8_t **data = nv12 ? src->nv12 : src->i420;
+    uint32_t *linesize = nv12 ? src->linesize_nv12 : src->linesize_i420;
+
+    const int pairs = c->height >> 1;
+    for (int band = 0; band < bands; band++) {
+        const int row_start = (pairs * band / bands) << 1;
+        const int row_end = band == bands - 1 ? c->height : (pairs * (band + 1) / bands) << 1;
+
+        if (scaler) {
+            if (nv12)
+                (uyvy ? scale_nv12_uyvy_rows : scale_nv12_yuyv_rows)(scaler, data, linesize, out,
+                    c->shift_x, c->shift_y, c->dest_width, c->dest_height, row_start, row_end);
+            else
+                (uyvy ? scale_yuv420_uyvy_rows : scale_yuv420_yuyv_rows)(scaler, data, linesize, out,
+                    c->shift_x, c->shift_y, c->dest_width, c->dest_height, row_start, row_end);
+        }
+        else {
+            if (nv12)
+                (uyvy ? map_nv12_uyvy_rows : map_nv12_yuyv_rows)(data, linesize, out,
+                    c->shift_x, c->shift_y, c->dest_width, c->dest_height,
+                    c->width, c->height, row_start, row_end);
+            else
+                (uyvy ? map_yuv420_uyvy_rows : map_yuv420_yuyv_rows)(data, linesize, out,
+                    c->shift_x, c->shift_y, c->dest_width, c->dest_height,
+                    c->width, c->height, row_start, row_end);
+        }
+    }
+}
+
+static void check_report(const char *what, const struct check_shape *c,
+    const uint8_t *ref, const uint8_t *out, size_t size)
+{
+    size_t i = 0;
+    while (i < size && ref[i] == out[i])
+        i++;
+
+    const size_t row_bytes = (size_t) c->dest_width * 2;
+    printf("MISMATCH %s src %dx%d image %dx%d dest %dx%d shift %d,%d: byte %d (row %d, col %d) %02x != %02x\n",
+        what, c->src_width, c->src_height, c->width, c->height,
+        c->dest_width, c->dest_height, c->shift_x, c->shift_y,
+        (int) i, (int) (i / row_bytes), (int) (i % row_bytes), out[i], ref[i]);
+}
+
+// One shape, every kind, level, band count and store kind.
+// Returns the number of mismatches.
+static int check_shape(uint8_t *ref, uint8_t *out, struct check_src *src,
+    const struct yuyv_scaler *scaler, const struct check_shape *c, int max_level, int *runs)
+{
+    static const int band_counts[] = { 1, 2, 3, 5 };
+    const size_t size = (size_t) c->dest_width * c->dest_height * 2 + CHECK_GUARD;
+    int errors = 0;
+
+    for (int kind = 0; kind < CHECK_KINDS; kind++) {
+        yuyv_set_cpu_level(CPU_LEVEL_SCALAR);
+        yuyv_set_stream_threshold(SIZE_MAX);
+        check_render(ref, kind, scaler, src, c, 1);
+
+        // the scalar frame itself: fully written, nothing after it
+        const size_t frame = size - CHECK_GUARD;
+        const uint8_t *hole = (const uint8_t *) memchr(ref, CHECK_CANARY, frame);
+        if (hole) {
+            const size_t i = (size_t) (hole - ref);
+            printf("MISMATCH %s image %dx%d dest %dx%d shift %d,%d: scalar left byte %d unwritten\n",
+                check_kind_names[kind], c->width, c->height, c->dest_width, c->dest_height,
+                c->shift_x, c->shift_y, (int) i);
+            errors++;
+        }
+        for (size_t i = frame; i < size; i++) {
+            if (ref[i] != CHECK_CANARY) {
+                printf("MISMATCH %s: scalar wrote past the frame\n", check_kind_names[kind]);
+                errors++;
+                break;
+            }
+        }
+
+        for (int level = max_level; level >= CPU_LEVEL_SCALAR; level--) {
+            for (int stream = 0; stream < 2; stream++) {
+                for (size_t b = 0; b < ARRAY_LEN(band_counts); b++) {
+                    yuyv_set_cpu_level(level);
+                    yuyv_set_stream_threshold(stream ? 0 : SIZE_MAX);
+                    check_render(out, kind, scaler, src, c, band_counts[b]);
+                    (*runs)++;
+                    if (memcmp(ref, out, size) == 0)
+                        continue;
+
+                    char what[96];
+                    snprintf(what, sizeof(what), "%s %s%s, %d bands", check_kind_names[kind],
+                        yuyv_cpu_level_name(level), stream ? " stream" : "", band_counts[b]);
+                    check_report(what, c, ref, out, size);
+                    errors++;
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+static int check_kernels(int max_level) {
+    static const int widths[] = {
+        2, 3, 14, 15, 16, 17, 31, 32, 33, 63, 64, 65, 66, 127, 129, 257, 641, 1278,
+    };
+    static const int heights[] = { 2, 6, 10 };
+    static const int shifts_x[] = { 0, 1, 2, 3, 5, 8, 16, 33 };
+    static const int shifts_y[] = { 0, 1, 3 };
+
+    // scaler sizes covering every mode plus odd output widths for the tails
+    static const struct { int src_w, src_h, w, h; } scales[] = {
+        {  128, 36,   64, 18 },  // 2:1
+        {  262, 40,  131, 20 },  // 2:1, odd
+        {  192, 36,  128, 24 },  // 3:2
+        {  291, 30,  194, 20 },  // 3:2, tail
+        {  256, 48,  192, 36 },  // 4:3
+        {  340, 20,  255, 15 },  // 4:3, odd
+        {  200, 40,  133, 27 },  // bilinear
+        {   64, 18,  130, 40 },  // up
+    };
+
+    const size_t max_src = 4096 * 64;
+    const size_t max_out = (size_t) 2048 * 64 * 2 + CHECK_GUARD;
+    struct check_src src;
+    src.i420[0] = (uint8_t *) alloc_aligned(max_src);
+    src.i420[1] = (uint8_t *) alloc_aligned(max_src / 4);
+    src.i420[2] = (uint8_t *) alloc_aligned(max_src / 4);
+    src.nv12[0] = src.i420[0];
+    src.nv12[1] = (uint8_t *) alloc_aligned(max_src / 2);
+    uint8_t *ref = (uint8_t *) alloc_aligned(max_out);
+    uint8_t *out = (uint8_t *) alloc_aligned(max_out);
+
+    const size_t threshold = yuyv_stream_threshold();
+    int errors = 0, runs = 0;
+
+    for (size_t w = 0; w < ARRAY_LEN(widths); w++) {
+        for (size_t h = 0; h < ARRAY_LEN(heights); h++) {
+            check_fill_src(&src, widths[w], heights[h]);
+            for (size_t sx = 0; sx < ARRAY_LEN(shifts_x); sx++) {
+                for (size_t sy = 0; sy < ARRAY_LEN(shifts_y); sy++) {
+                    for (int extra = 0; extra <= 6; extra += 6) {
+                        struct check_shape c;
+                        c.src_width = c.src_height = 0;
+                        c.width = widths[w];
+                        c.height = heights[h];
+                        c.shift_x = shifts_x[sx];
+                        c.shift_y = shifts_y[sy];
+                        // webcam sizes come in pixel pairs
+                        c.dest_width = (c.width + c.shift_x + extra + 1) & ~1;
+                        c.dest_height = c.height + c.shift_y + extra;
+                        errors += check_shape(ref, out, &src, NULL, &c, max_level, &runs);
+                    }
+                }
+            }
+        }
+    }
+
+    struct yuyv_scaler scaler;
+    memset(&scaler, 0, sizeof(scaler));
+    for (size_t i = 0; i < ARRAY_LEN(scales); i++) {
+        if (!yuyv_scaler_init(&scaler, scales[i].src_w, scales[i].src_h, scales[i].w, scales[i].h)) {
+            printf("MISMATCH scaler %dx%d -> %dx%d not supported\n",
+                scales[i].src_w, scales[i].src_h, scales[i].w, scales[i].h);
+            errors++;
+            continue;
+        }
+
+        check_fill_src(&src, scales[i].src_w, scales[i].src_h);
+        for (size_t sx = 0; sx < 4; sx++) {
+            struct check_shape c;
+            c.src_width = scales[i].src_w;
+            c.src_height = scales[i].src_h;
+            c.width = scales[i].w;
+            c.height = scales[i].h;
+            c.shift_x = shifts_x[sx];
+            c.shift_y = (int) sx;
+            c.dest_width = (c.width + c.shift_x + 1) & ~1;
+            c.dest_height = c.height + c.shift_y;
+            errors += check_shape(ref, out, &src, &scaler, &c, max_level, &runs);
+        }
+    }
+    yuyv_scaler_free(&scaler);
+
+    // plain copies, against memcpy
+    static const int copy_bytes[] = { 1, 15, 64, 127, 128, 129, 1000, 4099 };
+    for (size_t i = 0; i < ARRAY_LEN(copy_bytes); i++) {
+        for (int offset = 0; offset < 17; offset++) {
+            for (int stream = 0; stream < 2; stream++) {
+                const int bytes = copy_bytes[i], rows = 3, linesize = bytes + 40;
+                memset(ref, CHECK_CANARY, (size_t) linesize * rows);
+                memset(out, CHECK_CANARY, (size_t) linesize * rows);
+                for (int y = 0; y < rows; y++)
+                    memcpy(ref + offset + y * linesize, src.i420[0] + y * 97, bytes);
+
+                yuyv_set_cpu_level(max_level);
+                copy_plane_rows(out + offset, linesize, src.i420[0], 97, bytes, rows, stream);
+                runs++;
+                if (memcmp(ref, out, (size_t) linesize * rows) != 0) {
+                    printf("MISMATCH copy %d bytes at offset %d%s\n", bytes, offset, stream ? " stream" : "");
+                    errors++;
+                }
+            }
+        }
+    }
+
+    yuyv_set_cpu_level(max_level);
+    yuyv_set_stream_threshold(threshold);
+    free_aligned(src.i420[0]);
+    free_aligned(src.i420[1]);
+    free_aligned(src.i420[2]);
+    free_aligned(src.nv12[1]);
+    free_aligned(ref);
+    free_aligned(out);
+
+    printf("check: %d runs against scalar, %d mismatches\n", runs, errors);
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    int budget_ms = 500;
+    int check_only = 0;
+    const char *filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            budget_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0)
+            check_only = 1;
+        else
+            filter = argv[i];
+    }
+
+    // avx512 is opt-in in the plugin, the benchmark always covers it
+    const int max_level = yuyv_set_cpu_level(CPU_LEVEL_AVX512);
+    printf("cpu level: %s\n", yuyv_cpu_level_name(max_level));
+
+    if (check_kernels(max_level) != 0)
+        return 1;
+    if (check_only)
+        return 0;
+
+    const size_t dst_size = (size_t) MAX_WIDTH * MAX_HEIGHT * 2;
+    uint8_t *dst = (uint8_t *) alloc_aligned(dst_size);
+    uint8_t *planes[3];
+    planes[0] = (uint8_t *) alloc_aligned((size_t) MAX_WIDTH * MAX_HEIGHT);
+    planes[1] = (uint8_t *) alloc_aligned((size_t) MAX_WIDTH * MAX_HEIGHT / 4);
+    planes[2] = (uint8_t *) alloc_aligned((size_t) MAX_WIDTH * MAX_HEIGHT / 4);
+    uint8_t *nv12[2];
+    nv12[0] = planes[0];
+    nv12[1] = (uint8_t *) alloc_aligned((size_t) MAX_WIDTH * MAX_HEIGHT / 2);
+    if (!dst || !planes[0] || !planes[1] || !planes[2] || !nv12[1]) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < (size_t) MAX_WIDTH * MAX_HEIGHT; i++)
+        planes[0][i] = (uint8_t)(i * 7);
+    for (size_t i = 0; i < (size_t) MAX_WIDTH * MAX_HEIGHT / 4; i++) {
+        planes[1][i] = (uint8_t)(i * 3);
+        planes[2][i] = (uint8_t)(i * 5);
+        nv12[1][i<<1] = planes[1][i];
+        nv12[1][(i<<1) + 1] = planes[2][i];
+    }
+    memset(dst, 0, dst_size);
+
+
+    printf("%-24s %-8s %12s %8s %10s %8s\n",
+        "case", "variant", "ns/frame", "GB/s", "cycles/px", "frames");
+
+    for (size_t c = 0; c < ARRAY_LEN(cases); c++) {
+        const struct bench_case *bc = &cases[c];
+        if (filter && !strstr(bc->name, filter))
+            continue;
+
+        // OBS hands us planes with 32-byte aligned line sizes
+        uint32_t linesize[3];
+        linesize[0] = (bc->width + 31) & ~31;
+        linesize[1] = ((bc->width / 2) + 31) & ~31;
+        linesize[2] = linesize[1];
+
+        const double pixels = (double) bc->width * bc->height;
+        const double bytes = pixels * 1.5 + pixels * 2;
+
+        // every level the cpu supports, widest first
+        for (int level = max_level; level >= CPU_LEVEL_SCALAR; level--) {
+            yuyv_set_cpu_level(level);
+            struct result r;
+            RUN_TIMED(budget_ms, r, map_yuv420_yuyv(planes, linesize, dst,
+                bc->shift_x, bc->shift_y,
+                bc->dest_width, bc->dest_height, bc->width, bc->height));
+
+            print_result(bc->name, yuyv_cpu_level_name(level), &r, bytes, pixels);
+        }
+    }
+
+    for (size_t c = 0; c < ARRAY_LEN(cases); c++) {
+        const struct bench_case *bc = &cases[c];
+        char name[64];
+        snprintf(name, sizeof(name), "nv12-%s", bc->name);
+        if (filter && !strstr(name, filter))
+            continue;
+
+        uint32_t linesize[2];
+        linesize[0] = (bc->width + 31) & ~31;
+        linesize[1] = linesize[0];
+
+        const double pixels = (double) bc->width * bc->height;
+        const double bytes = pixels * 1.5 + pixels * 2;
+
+        for (int level = max_level; level >= CPU_LEVEL_SCALAR; level--) {
+            yuyv_set_cpu_level(level);
+            struct result r;
+            RUN_TIMED(budget_ms, r, map_nv12_yuyv(nv12, linesize, dst,
+                bc->shift_x, bc->shift_y,
+                bc->dest_width, bc->dest_height, bc->width, bc->height));
+
+            print_result(name, yuyv_cpu_level_name(level), &r, bytes, pixels);
+        }
+    }
+
+    for (size_t c = 0; c < ARRAY_LEN(cases); c++) {
+        const struct bench_case *bc = &cases[c];
+        char name[64];
+        snprintf(name, sizeof(name), "uyvy-%s", bc->name);
+        if (filter && !strstr(name, filter))
+            continue;
+
+        uint32_t linesize[3];
+        linesize[0] = (bc->width + 31) & ~31;
+        linesize[1] = ((bc->width / 2) + 31) & ~31;
+        linesize[2] = linesize[1];
+
+        const double pixels = (double) bc->width * bc->height;
+        const double bytes = pixels * 1.5 + pixels * 2;
+
+        for (int level = max_level; level >= CPU_LEVEL_SCALAR; level--) {
+            yuyv_set_cpu_level(level);
+            struct result r;
+            RUN_TIMED(budget_ms, r, map_yuv420_uyvy_rows(planes, linesize, dst,
+                bc->shift_x, bc->shift_y,
+                bc->dest_width, bc->dest_height, bc->width, bc->height, 0, bc->height));
+
+            print_result(name, yuyv_cpu_level_name(level), &r, bytes, pixels);
+        }
+    }
+
+    // nv12 in, nv12 out: the passthrough path, one plane copy each
+    for (size_t c = 0; c < ARRAY_LEN(cases); c++) {
+        const struct bench_case *bc = &cases[c];
+        if (bc->width != bc->dest_width || bc->height != bc->dest_height)
+            continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "copy-nv12-%s", bc->name);
+        if (filter && !strstr(name, filter))
+            continue;
+
+        const int w = bc->width, h = bc->height;
+        const double pixels = (double) w * h;
+        // only sse2 or plain memcpy here
+        const int levels[] = { CPU_LEVEL_SIMD128, CPU_LEVEL_SCALAR };
+        for (size_t l = 0; l < ARRAY_LEN(levels); l++) {
+            const int level = yuyv_set_cpu_level(levels[l]);
+            struct result r;
+            const int stream = yuyv_use_stream(pixels * 3 / 2);
+            RUN_TIMED(budget_ms, r, (
+                copy_plane_rows(dst, w, nv12[0], w, w, h, stream),
+                copy_plane_rows(dst + (size_t) w * h, w, nv12[1], w, w, h / 2, stream)));
+
+            print_result(name, yuyv_cpu_level_name(level), &r, pixels * 3, pixels);
+        }
+    }
+    yuyv_set_cpu_level(max_level);
+
+    struct yuyv_scaler scaler;
+    memset(&scaler, 0, sizeof(scaler));
+    for (size_t c = 0; c < ARRAY_LEN(scale_cases); c++) {
+        const struct scale_case *sc = &scale_cases[c];
+        if (filter && !strstr(sc->name, filter))
+            continue;
+
+        if (!yuyv_scaler_init(&scaler, sc->src_width, sc->src_height, sc->width, sc->height)) {
+            printf("%-24s unsupported\n", sc->name);
+            continue;
+        }
+
+        uint32_t linesize[3];
+        linesize[0] = (sc->src_width + 31) & ~31;
+        linesize[1] = ((sc->src_width / 2) + 31) & ~31;
+        linesize[2] = linesize[1];
+
+        const double pixels = (double) sc->width * sc->height;
+        const double bytes = (double) sc->src_width * sc->src_height * 1.5 + pixels * 2;
+
+        for (int level = max_level; level >= CPU_LEVEL_SCALAR; level--) {
+            yuyv_set_cpu_level(level);
+            struct result r;
+            RUN_TIMED(budget_ms, r, scale_yuv420_yuyv(&scaler, planes, linesize, dst,
+                sc->shift_x, sc->shift_y, sc->dest_width, sc->dest_height));
+
+            print_result(sc->name, yuyv_cpu_level_name(level), &r, bytes, pixels);
+        }
+    }
+    yuyv_scaler_free(&scaler);
+    yuyv_set_cpu_level(max_level);
+
+    for (size_t c = 0; c < ARRAY_LEN(cases); c++) {
+        const struct bench_case *bc = &cases[c];
+        if (bc->width != bc->dest_width || bc->height != bc->dest_height)
+            continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "clear-%s", bc->name);
+        if (filter && !strstr(name, filter))
+            continue;
+
+        const int size = bc->dest_width * bc->dest_height * 2;
+        struct result r;
+        RUN_TIMED(budget_ms, r, clear_yuyv(dst, size, 0x80008000));
+        print_result(name, "default", &r, size, (double) bc->dest_width * bc->dest_height);
+    }
+
+    for (size_t c = 0; c < ARRAY_LEN(cases); c++) {
+        const struct bench_case *bc = &cases[c];
+        if (bc->width == bc->dest_width && bc->height == bc->dest_height)
+            continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "borders-%s", bc->name);
+        if (filter && !strstr(name, filter))
+            continue;
+
+        const double pixels = (double) bc->dest_width * bc->dest_height
+            - (double) bc->width * bc->height;
+        struct result r;
+        RUN_TIMED(budget_ms, r, clear_yuyv_borders(dst, bc->dest_width, bc->dest_height,
+            bc->shift_x, bc->shift_y, bc->width, bc->height, 0x80008000));
+        print_result(name, "default", &r, pixels * 2, pixels);
+    }
+
+    // cached vs streaming stores, conversion plus the consumer's read
+    volatile uint64_t sink = 0;
+    const char *crossover = NULL;
+    char crossover_name[64];
+    for (size_t c = 0; c < ARRAY_LEN(crossover_sizes); c++) {
+        const int w = crossover_sizes[c].width, h = crossover_sizes[c].height;
+        char name[64];
+        snprintf(name, sizeof(name), "crossover-%dx%d", w, h);
+        if (filter && !strstr(name, filter))
+            continue;
+
+        uint32_t linesize[2];
+        linesize[0] = linesize[1] = (w + 31) & ~31;
+        const size_t frame = (size_t) w * h * 2;
+        const double pixels = (double) w * h;
+
+        struct result cached, streamed;
+        const size_t threshold = yuyv_set_stream_threshold(SIZE_MAX);
+        RUN_TIMED(budget_ms, cached, (
+            map_nv12_yuyv(nv12, linesize, dst, 0, 0, w, h, w, h),
+            sink += read_frame(dst, frame)));
+        yuyv_set_stream_threshold(0);
+        RUN_TIMED(budget_ms, streamed, (
+            map_nv12_yuyv(nv12, linesize, dst, 0, 0, w, h, w, h),
+            sink += read_frame(dst, frame)));
+        yuyv_set_stream_threshold(threshold);
+
+        print_result(name, "cached", &cached, pixels * 1.5 + frame * 2, pixels);
+        print_result(name, "stream", &streamed, pixels * 1.5 + frame * 2, pixels);
+        if (!crossover && streamed.ns_per_frame < cached.ns_per_frame) {
+            snprintf(crossover_name, sizeof(crossover_name), "%dx%d, %d KB", w, h, (int) (frame >> 10));
+            crossover = crossover_name;
+        }
+    }
+    if (!filter || strstr("crossover", filter)) {
+        printf("crossover: %s, threshold %d KB (llc %d KB)\n",
+            crossover ? crossover : "none, cached stores won at every size",
+            (int) (yuyv_stream_threshold() >> 10), (int) (yuyv_llc_size() >> 10));
+    }
+
+    if (!filter || strstr("clear-max", filter)) {
+        struct result r;
+        RUN_TIMED(budget_ms, r, clear_yuyv(dst, (int) dst_size, 0x80008000));
+        print_result("clear-max", "default", &r, (double) dst_size, (double) MAX_WIDTH * MAX_HEIGHT);
+    }
+
+    free_aligned(planes[0]);
+    free_aligned(planes[1]);
+    free_aligned(planes[2]);
+    free_aligned(nv12[1]);
+    free_aligned(dst);
+    return 0;
+}
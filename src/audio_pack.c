@@ -0,0 +1,269 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "simd.h"
+#include "audio_pack.h"
+#include "structs.h"
+#include "yuv420_yuyv.h"
+
+#define S16_SCALE 32767.0f
+#define S24_SCALE 8388607.0f
+
+// Frames per pass of the generic path, quantized per plane first
+#define PACK_BLOCK 64
+
+int audio_sample_bytes(int format) {
+    switch (format) {
+    case SAMPLE_FMT_S16: return 2;
+    case SAMPLE_FMT_S24: return 3;
+    case SAMPLE_FMT_F32: return 4;
+    default:             return 0;
+    }
+}
+
+// NaN ends up at -1, same as maxps / fmaxnm
+static inline float clamp_sample(float x) {
+    x = x > -1.0f ? x : -1.0f;
+    return x < 1.0f ? x : 1.0f;
+}
+
+static inline int32_t quantize(float x, float scale) {
+    return (int32_t) lrintf(clamp_sample(x) * scale);
+}
+
+static inline void store_sample(uint8_t *dst, int format, int32_t q) {
+    switch (format) {
+    case SAMPLE_FMT_S16: {
+        const int16_t s = (int16_t) q;
+        memcpy(dst, &s, 2);
+        break;
+    }
+    case SAMPLE_FMT_S24:
+        dst[0] = (uint8_t) q;
+        dst[1] = (uint8_t) (q >> 8);
+        dst[2] = (uint8_t) (q >> 16);
+        break;
+    default:
+        memcpy(dst, &q, 4);  // float bits
+        break;
+    }
+}
+
+// One plane into 32-bit words: integers, or the clamped float's bits
+typedef void (*quantize_fn)(int32_t *dst, const float *src, int count, int format);
+
+static void quantize_scalar(int32_t *dst, const float *src, int count, int format) {
+    const float scale = format == SAMPLE_FMT_S24 ? S24_SCALE : S16_SCALE;
+    for (int i = 0; i < count; i++) {
+        if (format == SAMPLE_FMT_F32) {
+            const float f = clamp_sample(src[i]);
+            memcpy(dst + i, &f, 4);
+        } else {
+            dst[i] = quantize(src[i], scale);
+        }
+    }
+}
+
+#if HAVE_SSE2
+static inline __m128 clamp_ps(__m128 x) {
+    return _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+}
+
+static inline __m128i quantize_ps(__m128 x, __m128 scale) {
+    return _mm_cvtps_epi32(_mm_mul_ps(clamp_ps(x), scale));
+}
+
+static void quantize_sse2(int32_t *dst, const float *src, int count, int format) {
+    const __m128 scale = _mm_set1_ps(format == SAMPLE_FMT_S24 ? S24_SCALE : S16_SCALE);
+    const int body = count & ~3;
+    for (int i = 0; i < body; i += 4) {
+        const __m128 x = _mm_loadu_ps(src + i);
+        const __m128i q = format == SAMPLE_FMT_F32
+            ? _mm_castps_si128(clamp_ps(x)) : quantize_ps(x, scale);
+        _mm_storeu_si128((__m128i*)(dst + i), q);
+    }
+
+    quantize_scalar(dst + body, src + body, count - body, format);
+}
+
+// Stereo and mono, the common cases, go straight to the interleaved
+// output. They return how many frames they did, the rest is left to
+// the generic path.
+static int pack_stereo_s16_sse2(uint8_t *dst, const float *l, const float *r, int frames) {
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    const int body = frames & ~7;
+    for (int i = 0; i < body; i += 8) {
+        const __m128i ql = _mm_packs_epi32(quantize_ps(_mm_loadu_ps(l + i), scale),
+                                           quantize_ps(_mm_loadu_ps(l + i + 4), scale));
+        const __m128i qr = _mm_packs_epi32(quantize_ps(_mm_loadu_ps(r + i), scale),
+                                           quantize_ps(_mm_loadu_ps(r + i + 4), scale));
+        _mm_storeu_si128((__m128i*)(dst + (i << 2)),      _mm_unpacklo_epi16(ql, qr));
+        _mm_storeu_si128((__m128i*)(dst + (i << 2) + 16), _mm_unpackhi_epi16(ql, qr));
+    }
+    return body;
+}
+
+static int pack_mono_s16_sse2(uint8_t *dst, const float *m, int frames) {
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    const int body = frames & ~7;
+    for (int i = 0; i < body; i += 8) {
+        _mm_storeu_si128((__m128i*)(dst + (i << 1)),
+            _mm_packs_epi32(quantize_ps(_mm_loadu_ps(m + i), scale),
+                            quantize_ps(_mm_loadu_ps(m + i + 4), scale)));
+    }
+    return body;
+}
+
+static int pack_stereo_f32_sse2(uint8_t *dst, const float *l, const float *r, int frames) {
+    const int body = frames & ~3;
+    for (int i = 0; i < body; i += 4) {
+        const __m128 vl = clamp_ps(_mm_loadu_ps(l + i));
+        const __m128 vr = clamp_ps(_mm_loadu_ps(r + i));
+        _mm_storeu_ps((float*)(dst + (i << 3)),      _mm_unpacklo_ps(vl, vr));
+        _mm_storeu_ps((float*)(dst + (i << 3) + 16), _mm_unpackhi_ps(vl, vr));
+    }
+    return body;
+}
+#endif
+
+#if HAVE_NEON
+static inline float32x4_t clamp_f32x4(float32x4_t x) {
+    return vminnmq_f32(vmaxnmq_f32(x, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+}
+
+static inline int32x4_t quantize_f32x4(float32x4_t x, float scale) {
+    return vcvtnq_s32_f32(vmulq_n_f32(clamp_f32x4(x), scale));
+}
+
+static void quantize_neon(int32_t *dst, const float *src, int count, int format) {
+    const float scale = format == SAMPLE_FMT_S24 ? S24_SCALE : S16_SCALE;
+    const int body = count & ~3;
+    for (int i = 0; i < body; i += 4) {
+        const float32x4_t x = vld1q_f32(src + i);
+        const int32x4_t q = format == SAMPLE_FMT_F32
+            ? vreinterpretq_s32_f32(clamp_f32x4(x)) : quantize_f32x4(x, scale);
+        vst1q_s32(dst + i, q);
+    }
+
+    quantize_scalar(dst + body, src + body, count - body, format);
+}
+
+static int pack_stereo_s16_neon(uint8_t *dst, const float *l, const float *r, int frames) {
+    const int body = frames & ~7;
+    for (int i = 0; i < body; i += 8) {
+        int16x8x2_t q;
+        q.val[0] = vcombine_s16(vqmovn_s32(quantize_f32x4(vld1q_f32(l + i), S16_SCALE)),
+                                vqmovn_s32(quantize_f32x4(vld1q_f32(l + i + 4), S16_SCALE)));
+        q.val[1] = vcombine_s16(vqmovn_s32(quantize_f32x4(vld1q_f32(r + i), S16_SCALE)),
+                                vqmovn_s32(quantize_f32x4(vld1q_f32(r + i + 4), S16_SCALE)));
+        vst2q_s16((int16_t*)(dst + (i << 2)), q);
+    }
+    return body;
+}
+
+static int pack_mono_s16_neon(uint8_t *dst, const float *m, int frames) {
+    const int body = frames & ~7;
+    for (int i = 0; i < body; i += 8) {
+        vst1q_s16((int16_t*)(dst + (i << 1)),
+            vcombine_s16(vqmovn_s32(quantize_f32x4(vld1q_f32(m + i), S16_SCALE)),
+                         vqmovn_s32(quantize_f32x4(vld1q_f32(m + i + 4), S16_SCALE))));
+    }
+    return body;
+}
+
+static int pack_stereo_f32_neon(uint8_t *dst, const float *l, const float *r, int frames) {
+    const int body = frames & ~3;
+    for (int i = 0; i < body; i += 4) {
+        float32x4x2_t v;
+        v.val[0] = clamp_f32x4(vld1q_f32(l + i));
+        v.val[1] = clamp_f32x4(vld1q_f32(r + i));
+        vst2q_f32((float*)(dst + (i << 3)), v);
+    }
+    return body;
+}
+#endif
+
+static quantize_fn select_quantize_fn(void) {
+    #if HAVE_SSE2
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return quantize_sse2;
+    #elif HAVE_NEON
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return quantize_neon;
+    #endif
+    return quantize_scalar;
+}
+
+// Frames packed by a dedicated kernel, from the start
+static int pack_fast(uint8_t *dst, int format, const float *const *src,
+    int offset, int frames, int channels)
+{
+    #if HAVE_SSE2 || HAVE_NEON
+    if (yuyv_cpu_level() < CPU_LEVEL_SIMD128)
+        return 0;
+
+    #if HAVE_SSE2
+    #define PACK(name) name##_sse2
+    #else
+    #define PACK(name) name##_neon
+    #endif
+    if (channels == 2 && format == SAMPLE_FMT_S16)
+        return PACK(pack_stereo_s16)(dst, src[0] + offset, src[1] + offset, frames);
+    if (channels == 1 && format == SAMPLE_FMT_S16)
+        return PACK(pack_mono_s16)(dst, src[0] + offset, frames);
+    if (channels == 2 && format == SAMPLE_FMT_F32)
+        return PACK(pack_stereo_f32)(dst, src[0] + offset, src[1] + offset, frames);
+    #undef PACK
+    #endif
+
+    (void) dst; (void) format; (void) src; (void) offset; (void) frames; (void) channels;
+    return 0;
+}
+
+void audio_pack(uint8_t *dst, int format, const float *const *src,
+    int offset, int frames, int channels)
+{
+    const int sample_bytes = audio_sample_bytes(format);
+    const int frame_bytes = sample_bytes * channels;
+    if (!sample_bytes || channels > MAX_CHANNELZ)
+        return;
+
+    const int done = pack_fast(dst, format, src, offset, frames, channels);
+    dst += done * frame_bytes;
+    offset += done;
+    frames -= done;
+
+    // the rest: quantize each plane, then interleave
+    quantize_fn quantize_plane = select_quantize_fn();
+    int32_t q[MAX_CHANNELZ][PACK_BLOCK];
+    while (frames > 0) {
+        const int n = frames < PACK_BLOCK ? frames : PACK_BLOCK;
+        for (int c = 0; c < channels; c++)
+            quantize_plane(q[c], src[c] + offset, n, format);
+
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < channels; c++)
+                store_sample(dst + c * sample_bytes, format, q[c][i]);
+            dst += frame_bytes;
+        }
+
+        offset += n;
+        frames -= n;
+    }
+}
@@ -0,0 +1,20 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bytes per sample of a SAMPLE_FMT_ format (structs.h), 0 if unknown
+int audio_sample_bytes(int format);
+
+// Interleave `frames` frames of planar float audio, starting at
+// src[c][offset], into dst in `format`. Samples are clamped to -1..1
+// and rounded to the nearest integer step.
+void audio_pack(uint8_t *dst, int format, const float *const *src,
+    int offset, int frames, int channels);
+
+#ifdef __cplusplus
+} // "C"
+#endif
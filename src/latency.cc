@@ -0,0 +1,89 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <util/platform.h>
+#include "plugin.h"
+#include "latency.h"
+
+static const char *stage_names[LAT_STAGES] = {
+    "queue", "convert", "publish", "total",
+    "queue", "ring", "pickup", "total",
+};
+
+const char *latency_stage_name(int stage) {
+    return (stage >= 0 && stage < LAT_STAGES) ? stage_names[stage] : "?";
+}
+
+void latency_stats_summary(LatencyStats *stats, LatencySummary out[LAT_STAGES]) {
+    uint32_t delta[LATENCY_BUCKETS];
+    stats->last_ns = os_gettime_ns();
+
+    for (int s = 0; s < LAT_STAGES; s++) {
+        LatencyHistogram &h = stats->stage[s];
+        LatencySummary &sum = out[s];
+        sum.count = 0;
+        sum.p50 = sum.p99 = sum.max = 0;
+        sum.peak = h.peak.load(std::memory_order_relaxed);
+
+        // counters only grow, unsigned differences survive wrapping
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            const uint32_t now = h.buckets[i].load(std::memory_order_relaxed);
+            delta[i] = now - stats->last[s][i];
+            stats->last[s][i] = now;
+            sum.count += delta[i];
+        }
+        if (sum.count == 0)
+            continue;
+
+        const uint64_t rank50 = (sum.count * 50 + 99) / 100;
+        const uint64_t rank99 = (sum.count * 99 + 99) / 100;
+        uint64_t seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            if (!delta[i])
+                continue;
+
+            const uint64_t before = seen;
+            seen += delta[i];
+            if (before < rank50 && seen >= rank50) sum.p50 = LatencyHistogram::bucket_max(i);
+            if (before < rank99 && seen >= rank99) sum.p99 = LatencyHistogram::bucket_max(i);
+            sum.max = LatencyHistogram::bucket_max(i);
+        }
+    }
+}
+
+static void dump_stages(const char *what, const LatencySummary *sum, int first, int last) {
+    if (sum[last].count == 0)
+        return;
+
+    char line[512];
+    int len = 0;
+    for (int s = first; s <= last && len < (int) sizeof(line); s++) {
+        len += snprintf(line + len, sizeof(line) - len, "%s%s %u/%u/%u",
+            s == first ? "" : ", ", latency_stage_name(s),
+            sum[s].p50, sum[s].p99, sum[s].max);
+    }
+
+    ilog("latency %s (p50/p99/max us): %s, n=%llu, peak %u us",
+        what, line, (unsigned long long) sum[last].count, sum[last].peak);
+}
+
+void latency_stats_dump(LatencyStats *stats) {
+    LatencySummary sum[LAT_STAGES];
+    latency_stats_summary(stats, sum);
+    dump_stages("video", sum, LAT_VIDEO_QUEUE, LAT_VIDEO_TOTAL);
+    dump_stages("audio", sum, LAT_AUDIO_QUEUE, LAT_AUDIO_TOTAL);
+}
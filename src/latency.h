@@ -0,0 +1,105 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Log-linear latency histograms, in microseconds.
+// Values below 2 * LATENCY_SUB are exact, above that every power of two
+// is split into LATENCY_SUB buckets, so any value is off by < 1/16.
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB      (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_US   ((1u << 26) - 1)   // ~67 seconds, larger values are clamped
+#define LATENCY_BUCKETS  ((26 - LATENCY_SUB_BITS + 1) * LATENCY_SUB)
+
+// Report interval of the control thread
+#define LATENCY_DUMP_SEC 30
+
+enum latency_stage {
+    // OBS frame time -> on_video entry -> converted -> published
+    LAT_VIDEO_QUEUE = 0,
+    LAT_VIDEO_CONVERT,
+    LAT_VIDEO_PUBLISH,
+    LAT_VIDEO_TOTAL,
+
+    // OBS frame time -> on_audio entry -> copied to shared memory
+    // -> taken by the consumer
+    LAT_AUDIO_QUEUE,
+    LAT_AUDIO_RING,
+    LAT_AUDIO_PICKUP,
+    LAT_AUDIO_TOTAL,
+
+    LAT_STAGES
+};
+
+// Each histogram has exactly one writer thread, so record() gets by
+// with plain loads and stores, any thread may read.
+struct LatencyHistogram {
+    std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint32_t> peak;
+
+    LatencyHistogram(void) : count(0), peak(0) {
+        for (int i = 0; i < LATENCY_BUCKETS; i++)
+            buckets[i].store(0, std::memory_order_relaxed);
+    }
+
+    static inline int bucket(uint32_t us) {
+        if (us < 2 * LATENCY_SUB)
+            return (int) us;
+
+        int msb = 31;
+        while (!(us >> msb)) msb--;
+        const int shift = msb - LATENCY_SUB_BITS;
+        return (shift + 1) * LATENCY_SUB + (int)((us >> shift) - LATENCY_SUB);
+    }
+
+    // Largest value that lands in bucket i
+    static inline uint32_t bucket_max(int i) {
+        if (i < 2 * LATENCY_SUB)
+            return (uint32_t) i;
+
+        const int shift = i / LATENCY_SUB - 1;
+        return ((uint32_t)(LATENCY_SUB + i % LATENCY_SUB + 1) << shift) - 1;
+    }
+
+    // Time between two os_gettime_ns() stamps,
+    // a stamp later than `to` counts as 0
+    inline void record(uint64_t from_ns, uint64_t to_ns) {
+        uint64_t us = (to_ns > from_ns) ? (to_ns - from_ns) / 1000 : 0;
+        if (us > LATENCY_MAX_US) us = LATENCY_MAX_US;
+
+        std::atomic<uint32_t> &b = buckets[bucket((uint32_t) us)];
+        b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        if ((uint32_t) us > peak.load(std::memory_order_relaxed))
+            peak.store((uint32_t) us, std::memory_order_relaxed);
+    }
+};
+
+struct LatencySummary {
+    uint64_t count;      // samples in the interval
+    uint32_t p50, p99;   // bucket upper bounds, us
+    uint32_t max;        // largest in the interval, same precision
+    uint32_t peak;       // largest since start, exact
+};
+
+struct LatencyStats {
+    LatencyHistogram stage[LAT_STAGES];
+
+    // bucket counts and time of the previous summary, owned by its caller
+    uint32_t last[LAT_STAGES][LATENCY_BUCKETS];
+    uint64_t last_ns;
+
+    LatencyStats(void) : last(), last_ns(0) {}
+};
+
+const char *latency_stage_name(int stage);
+
+// Per stage summary of the samples recorded since the previous call.
+// Only one thread may call it (or latency_stats_dump) at a time.
+void latency_stats_summary(LatencyStats *stats, LatencySummary out[LAT_STAGES]);
+
+// ilog the video and audio summaries, if there was anything recorded
+void latency_stats_dump(LatencyStats *stats);
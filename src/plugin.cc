@@ -15,12 +15,20 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <cmath>
+#include <cstdio>
 #include <util/config-file.h>
 #include <util/threading.h>
 #include <util/platform.h>
+#include "audio_pack.h"
+#include "latency.h"
 #include "plugin.h"
 #include "queue.h"
+#include "resample.h"
+#include "scale_yuyv.h"
 #include "structs.h"
+#include "transport.h"
+#include "workers.h"
+#include "yuv420_yuyv.h"
 
 #if DROIDCAM_OVERRIDE==0
 
@@ -36,33 +44,134 @@ QAction *tools_menu_action;
 
 const char *PluginVer  = "022";
 const char *PluginName = "DroidCam Virtual Output";
-obs_output_t *droidcam_virtual_output = NULL;
+obs_output_t *droidcam_virtual_output = NULL; // the Tools menu one, instance 0
 config_t *obs_config = NULL;
 
-void map_yuv420_yuyv(uint8_t** data, uint32_t *linesize, uint8_t* dst,
-    int shift_x, int shift_y, int is_aligned_128b,
-    const int dest_width, const int dest_height,
-    const int width, const int height);
+#define AUDIO_RING_SLOTS 64
+
+// How many queued chunks the audio thread builds up before handing them
+// to the consumer, and builds back up after running dry. Sized from what
+// the consumer actually needs: one OBS packet (they arrive in bursts) and
+// one chunk of slack, or the jitter between consumer pulls when that is
+// longer. Usual jitter so leaves the cushion, and the latency, where the
+// stream started; a stall grows it until the peak fades out.
+struct audio_cushion {
+    std::atomic<int> chunks;        // audio thread, read by on_audio
+    std::atomic<int> packet_frames; // on_audio, largest packet seen
+    std::atomic<int> chunk_frames;  // on_audio, frames per chunk
+    uint64_t last_pickup;
+    uint64_t jitter;                // decaying peak, ns
+    std::atomic<bool> reset;        // any thread -> audio thread
+};
+
+// The consumer pulls at its own clock, OBS delivers at the system clock.
+// Their ratio, from OBS timestamps against consumer pull times, is fed
+// forward to a resampler in on_audio, with a small correction that steers
+// the queue towards the cushion. A few ppm of difference would otherwise
+// end in an underrun or a dropped packet every few minutes.
+#define DRIFT_WINDOW_SEC 5      // shortest span the rates are measured over
+#define DRIFT_SETTLE_SEC 10     // how fast a queue error is worked off
+#define DRIFT_MAX_PPM    5000
+#define DRIFT_MIN_STEP   (RESAMPLE_ONE - RESAMPLE_ONE / 1000000 * DRIFT_MAX_PPM)
+#define DRIFT_MAX_STEP   (RESAMPLE_ONE + RESAMPLE_ONE / 1000000 * DRIFT_MAX_PPM)
+
+struct audio_drift {
+    std::atomic<uint64_t> step;     // audio thread -> on_audio, see resample_f32
+    std::atomic<double> obs_rate;   // on_audio, frames per second, 0 = not known yet
+
+    // on_audio, output goes to a shared scratch buffer
+    resampler rs;
+    uint64_t in_start, in_next;     // OBS timestamps
+    uint64_t in_frames;
+
+    // audio thread, the atomics are read by the control thread's log
+    uint64_t out_start;
+    uint64_t out_frames;
+    std::atomic<double> occupancy;  // frames queued at pickup, averaged
+    int samples;                    // pickups averaged while learning the target
+    std::atomic<double> target;     // occupancy to steer to, < 0 = still learning
+    int target_chunks;              // cushion when the target was taken
+    std::atomic<double> ppm;        // consumer vs OBS
+};
+
+// Which OBS frames the consumer will actually see, so the rest are
+// never converted. Consumer ticks every `interval`, starting from the
+// first frame. A frame stands for the ticks falling within half an OBS
+// interval of its timestamp: none -> skipped, more than one -> the
+// consumer reads it again (duplicated).
+struct video_pacing {
+    volatile long interval;     // consumer, 100ns units, set by the control thread
+    long active_interval;       // what next_due was computed with
+    uint64_t obs_interval_ns;
+    uint64_t next_due;          // next consumer tick, 0 = start over
+
+    std::atomic<uint64_t> converted;
+    std::atomic<uint64_t> skipped;
+    std::atomic<uint64_t> duplicated;
+};
+
+// What on_video writes for the consumer. There are two copies so the
+// control thread can move to a new webcam size or format between two
+// frames: it fills the spare one and flips video_active, on_video acks
+// the copy it runs with in video_seen. The spare is only written again
+// once video_seen == video_active.
+struct video_params {
+    unsigned gen;           // bumped on every change, see slot_gen
+    int webcam_w, webcam_h;
+    int shift_x, shift_y;
+    int image_w, image_h;   // converted image inside the webcam frame
+    int slots;              // 1 or VIDEO_FRAME_SLOTS
+
+    // FOURCC written to the slots.
+    // copy_frame: libobs hands us frames in out_format already.
+    unsigned out_format;
+    bool copy_frame;
 
-void clear_yuyv(uint8_t* dst, int size, int color);
+    // scaling is done by us while packing to yuyv,
+    // libobs only scales when the scaler could not be set up
+    bool fused_scale;
+    struct yuyv_scaler scaler;
+
+    // what libobs has to deliver, changing it means restarting capture
+    struct video_scale_info conv;
+};
+
+// Same for the audio chunks, acked by on_audio in audio_seen
+struct audio_params {
+    int frame_size_bytes;
+    int chunk_frames;
+    int sample_format;      // SAMPLE_FMT_*
+};
 
 struct droidcam_output_plugin {
+    int instance;   // -1 if taken by another output, see MAX_INSTANCES
+
     // video
-    int webcam_w, webcam_h;
     int default_w, default_h;
     int default_interval;
-    int shift_x, shift_y;
-    int is_aligned_128b;
+    enum video_format native_format;    // what OBS renders
+    video_params video[2];
+    std::atomic<int> video_active;
+    std::atomic<int> video_seen;
+    unsigned video_gen;
+    unsigned slot_gen[VIDEO_FRAME_SLOTS];   // on_video, borders cleared for
 
     // audio
     int default_sample_rate;
     enum speaker_layout default_speaker_layout;
+    audio_params audio[2];
+    std::atomic<int> audio_active;
+    std::atomic<int> audio_seen;
 
     //
     bool have_video;
     bool have_audio;
 
-    int audio_frame_size_bytes;
+    DataPacket *audio_fill;     // on_audio: chunk being filled
+    audio_cushion cushion;
+    audio_drift drift;
+
+    // as set on the output
     struct audio_convert_info audio_conv;
     struct video_scale_info   video_conv;
 
@@ -70,32 +179,136 @@ struct droidcam_output_plugin {
     obs_output_t *output;
     pthread_t audio_thread;
     pthread_t control_thread;
+    thread_policy audio_policy;
+    thread_policy control_policy;
+    thread_policy worker_policy;    // if this instance starts the shared pool
+    bool avx512;                    // same, opt in to the avx512 kernels
+    volatile uint64_t audio_cpus;   // see note_cpu()
+    volatile uint64_t control_cpus;
     os_event_t *stop_signal;
+    os_event_t *capture_stopped; // "deactivate" from obs
 
     //
-    #ifdef _WIN32
     volatile VideoHeader *pVideoHeader;
     volatile AudioHeader *pAudioHeader;
-    BYTE *pVideoData;
-    BYTE *pAudioData;
+    uint8_t *pVideoData;
+    uint8_t *pAudioData;
 
-    LPVOID pVideoMem;
-    HANDLE hVideoMapping;
-    HANDLE hVideoWrLock;
-    HANDLE hVideoRdLock;
+    SharedMem videoMem;
+    SharedEvent videoWrLock;
+    SharedEvent videoRdLock;
 
-    LPVOID pAudioMem;
-    HANDLE hAudioMapping;
-    DataQueue audioDataQueue;
-    #endif
+    SharedMem audioMem;
+    SharedEvent audioEvent;
+
+    SharedEvent controlEvent;
+    DataRing<AUDIO_RING_SLOTS> audioRing;
+
+    WorkerPool *workers;    // shared
+    LatencyStats latency;
+    video_pacing pacing;
 };
 
+// Shared by all instances, so another camera does not bring another set
+// of conversion threads and scratch buffers. Set up with the first
+// instance, torn down with the last.
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    int users;
+    unsigned instances;     // bit per instance in use
+    WorkerPool workers;
+
+    // resampler output, MAX_CHANNELZ planes of scratch_stride floats.
+    // on_audio takes one for the duration of a packet, there are only
+    // as many as there were concurrent on_audio calls.
+    std::atomic<float *> scratch[MAX_INSTANCES];
+    int scratch_stride;
+} shared;
+
+static float *shared_scratch_get(void) {
+    for (int i = 0; i < MAX_INSTANCES; i++) {
+        float *buf = shared.scratch[i].exchange(NULL, std::memory_order_acquire);
+        if (buf)
+            return buf;
+    }
+
+    return (float *) bmalloc(shared.scratch_stride * MAX_CHANNELZ * sizeof(float));
+}
+
+static void shared_scratch_put(float *buf) {
+    for (int i = 0; i < MAX_INSTANCES; i++) {
+        float *empty = NULL;
+        if (shared.scratch[i].compare_exchange_strong(empty, buf, std::memory_order_release))
+            return;
+    }
+
+    bfree(buf);
+}
+
+// Claims plugin->instance, or sets it to -1 if another output has it
+static void shared_acquire(droidcam_output_plugin *plugin) {
+    pthread_mutex_lock(&shared_lock);
+    if (shared.users++ == 0) {
+        worker_pool_init(&shared.workers, 0, &plugin->worker_policy);
+        const int level = yuyv_set_cpu_level(plugin->avx512 ? CPU_LEVEL_AVX512 : CPU_LEVEL_AVX2);
+        if (plugin->avx512)
+            ilog("conversion using %s", yuyv_cpu_level_name(level));
+        shared.scratch_stride = resample_max_out(DEF_FRAMES, DRIFT_MIN_STEP);
+        shared_scratch_put(shared_scratch_get());
+    }
+
+    const int instance = plugin->instance;
+    if (instance < 0 || instance >= MAX_INSTANCES || (shared.instances & (1u << instance))) {
+        elog("instance %d is not available", instance);
+        plugin->instance = -1;
+    } else {
+        shared.instances |= 1u << instance;
+    }
+
+    plugin->workers = &shared.workers;
+    pthread_mutex_unlock(&shared_lock);
+}
+
+static void shared_release(droidcam_output_plugin *plugin) {
+    pthread_mutex_lock(&shared_lock);
+    if (plugin->instance >= 0)
+        shared.instances &= ~(1u << plugin->instance);
+
+    if (--shared.users == 0) {
+        worker_pool_destroy(&shared.workers);
+        for (int i = 0; i < MAX_INSTANCES; i++)
+            bfree(shared.scratch[i].exchange(NULL));
+    }
+
+    plugin->workers = NULL;
+    pthread_mutex_unlock(&shared_lock);
+}
+
+// Shared memory and event names of an instance, see MAX_INSTANCES
+static const char *instance_name(char *buf, size_t size, const char *name, int instance) {
+    if (instance == 0)
+        return name;
+
+    snprintf(buf, size, "%s_%d", name, instance);
+    return buf;
+}
+
 static inline enum speaker_layout to_speaker_layout(int channels) {
     switch (channels) {
     case 1:
         return SPEAKERS_MONO;
     case 2:
         return SPEAKERS_STEREO;
+    case 3:
+        return SPEAKERS_2POINT1;
+    case 4:
+        return SPEAKERS_4POINT0;
+    case 5:
+        return SPEAKERS_4POINT1;
+    case 6:
+        return SPEAKERS_5POINT1;
+    case 8:
+        return SPEAKERS_7POINT1;
     default:
         return SPEAKERS_UNKNOWN;
     }
@@ -105,68 +318,346 @@ static inline int to_channels(enum speaker_layout speaker_layout) {
     switch (speaker_layout) {
     case SPEAKERS_STEREO:
         return 2;
+    case SPEAKERS_2POINT1:
+        return 3;
+    case SPEAKERS_4POINT0:
+        return 4;
+    case SPEAKERS_4POINT1:
+        return 5;
+    case SPEAKERS_5POINT1:
+        return 6;
+    case SPEAKERS_7POINT1:
+        return 8;
     case SPEAKERS_MONO:
     default:
         return 1;
     }
 }
 
-#define AUDIO_CUSHION 4
+// Sample formats the consumer can ask for, anything else gets 16-bit
+static inline int to_sample_format(int format) {
+    return audio_sample_bytes(format) ? format : SAMPLE_FMT_S16;
+}
+
+// Longest chunk that fits the data area
+static inline int max_chunk_frames(int frame_bytes) {
+    const int frames = AUDIO_CHUNK_BYTES / frame_bytes;
+    return frames < DEF_FRAMES ? frames : DEF_FRAMES;
+}
+
+#define CONTROL_POLL_MS 999
+#define CAPTURE_STOP_MS 50
+
+#define AUDIO_POLL_MS 5
+#define AUDIO_IDLE_MS 100
+
+// The audio event is raised by the consumer after taking a chunk and by
+// on_audio after queuing one. Consumers that never raise it (data_event=0)
+// get polled every AUDIO_POLL_MS like before.
+static inline void audio_thread_wait(droidcam_output_plugin *plugin) {
+    if (!SharedEventValid(&plugin->audioEvent)) {
+        os_event_timedwait(plugin->stop_signal, AUDIO_POLL_MS);
+        return;
+    }
+
+    const int timeout = (plugin->have_audio && !plugin->pAudioHeader->data_event)
+        ? AUDIO_POLL_MS : AUDIO_IDLE_MS;
+    WaitSharedEvent(&plugin->audioEvent, timeout);
+}
+
+static inline uint64_t audio_chunk_ns(droidcam_output_plugin *plugin) {
+    return (uint64_t) plugin->cushion.chunk_frames.load(std::memory_order_relaxed)
+        * RefTime::NANO_SEC / plugin->audio_conv.samples_per_sec;
+}
+
+static void audio_cushion_reset(droidcam_output_plugin *plugin) {
+    audio_cushion *c = &plugin->cushion;
+    c->last_pickup = 0;
+    c->jitter = 0;
+    c->packet_frames.store(0, std::memory_order_relaxed);
+    c->chunks.store(2, std::memory_order_relaxed);
+
+    audio_drift *d = &plugin->drift;
+    d->out_start = 0;
+    d->out_frames = 0;
+    d->occupancy.store(0, std::memory_order_relaxed);
+    d->samples = 0;
+    d->target.store(-1, std::memory_order_relaxed);
+    d->target_chunks = 0;
+    d->ppm.store(0, std::memory_order_relaxed);
+    d->step.store(RESAMPLE_ONE, std::memory_order_relaxed);
+}
+
+static void audio_cushion_update(droidcam_output_plugin *plugin) {
+    audio_cushion *c = &plugin->cushion;
+    const uint64_t packet_ns = (uint64_t) c->packet_frames.load(std::memory_order_relaxed)
+        * RefTime::NANO_SEC / plugin->audio_conv.samples_per_sec;
+
+    const uint64_t chunk_ns = audio_chunk_ns(plugin);
+    const uint64_t slack = c->jitter > chunk_ns ? c->jitter : chunk_ns;
+    const uint64_t need = packet_ns + slack;
+    int chunks = (int) ((need + chunk_ns - 1) / chunk_ns);
+    if (chunks < 2) chunks = 2;
+    if (chunks > AUDIO_RING_SLOTS / 2) chunks = AUDIO_RING_SLOTS / 2;
+
+    if (chunks != c->chunks.load(std::memory_order_relaxed)) {
+        dlog("audio cushion: %d x %d frames, jitter %d us", chunks,
+            c->chunk_frames.load(std::memory_order_relaxed), (int) (c->jitter / 1000));
+        c->chunks.store(chunks, std::memory_order_relaxed);
+    }
+}
+
+// The consumer took a chunk of `frames`, steer the resampler
+static void audio_drift_pickup(droidcam_output_plugin *plugin, uint64_t now, int frames) {
+    audio_drift *d = &plugin->drift;
+    const double rate = plugin->audio_conv.samples_per_sec;
+    const int chunk_frames = plugin->cushion.chunk_frames.load(std::memory_order_relaxed);
+
+    // frames pulled after out_start, over the time since
+    if (!d->out_start) {
+        d->out_start = now;
+        d->out_frames = 0;
+    } else {
+        d->out_frames += frames;
+    }
+
+    // plain mean until the target is taken, slow average after
+    const double queued = (double) plugin->audioRing.size() * chunk_frames;
+    const int chunks = plugin->cushion.chunks.load(std::memory_order_relaxed);
+    double occupancy = d->occupancy.load(std::memory_order_relaxed);
+    double base = d->target.load(std::memory_order_relaxed);
+    if (base < 0) {
+        d->samples++;
+        occupancy += (queued - occupancy) / d->samples;
+    } else {
+        occupancy += (queued - occupancy) / 128;
+    }
+    d->occupancy.store(occupancy, std::memory_order_relaxed);
+
+    double step = 1.0;
+    const double obs_rate = d->obs_rate.load(std::memory_order_relaxed);
+    if (obs_rate <= 0 || now - d->out_start < DRIFT_WINDOW_SEC * (uint64_t) RefTime::NANO_SEC) {
+        if (base < 0)
+            return;
+    } else {
+        const double consumer_rate = d->out_frames * (double) RefTime::NANO_SEC / (double) (now - d->out_start);
+        d->ppm.store((consumer_rate / obs_rate - 1.0) * 1e6, std::memory_order_relaxed);
+        step = obs_rate / consumer_rate;
+
+        // Where the queue sat over the first window is where the latency
+        // stays: the cushion it started from, whatever the phase between
+        // OBS packets and consumer pulls.
+        if (base < 0) {
+            base = occupancy;
+            d->target.store(base, std::memory_order_relaxed);
+            d->target_chunks = chunks;
+        }
+    }
+
+    // a cushion grown by jitter raises the target, it comes back down as
+    // the peak fades
+    double target = base + (double) (chunks - d->target_chunks) * chunk_frames;
+    if (target < chunk_frames) target = chunk_frames;
+    step *= 1.0 + (occupancy - target) / (rate * DRIFT_SETTLE_SEC);
+
+    uint64_t q = (uint64_t) (step * (double) RESAMPLE_ONE);
+    if (q < DRIFT_MIN_STEP) q = DRIFT_MIN_STEP;
+    if (q > DRIFT_MAX_STEP) q = DRIFT_MAX_STEP;
+    d->step.store(q, std::memory_order_relaxed);
+}
+
+// OBS side of the rate, on_audio
+static void audio_drift_input(droidcam_output_plugin *plugin, struct audio_data *frame) {
+    audio_drift *d = &plugin->drift;
+    const uint64_t ts = frame->timestamp;
+    const uint64_t slack = 50 * (RefTime::NANO_SEC / RefTime::MILLI_SEC);
+
+    // OBS resyncs its audio timestamps now and then, start over on a jump
+    if (!d->in_start || ts + slack < d->in_next || ts > d->in_next + slack) {
+        d->in_start = ts;
+        d->in_frames = 0;
+    }
+    else if (ts - d->in_start >= DRIFT_WINDOW_SEC * (uint64_t) RefTime::NANO_SEC) {
+        d->obs_rate.store(d->in_frames * (double) RefTime::NANO_SEC / (double) (ts - d->in_start),
+            std::memory_order_relaxed);
+    }
+
+    d->in_frames += frame->frames;
+    d->in_next = ts + (uint64_t) frame->frames * RefTime::NANO_SEC / plugin->audio_conv.samples_per_sec;
+}
+
+// The consumer took a chunk
+static void audio_cushion_pickup(droidcam_output_plugin *plugin, uint64_t now) {
+    audio_cushion *c = &plugin->cushion;
+    if (c->last_pickup) {
+        const uint64_t chunk_ns = audio_chunk_ns(plugin);
+        const uint64_t interval = now - c->last_pickup;
+        const uint64_t jitter = interval > chunk_ns
+            ? interval - chunk_ns : chunk_ns - interval;
+
+        // peaks hold for a few hundred pulls, then fade out
+        c->jitter -= c->jitter / 256;
+        if (jitter > c->jitter)
+            c->jitter = jitter;
+    }
+
+    c->last_pickup = now;
+    audio_cushion_update(plugin);
+}
+
+// The consumer was ready and there was nothing to give it
+static void audio_cushion_underrun(droidcam_output_plugin *plugin) {
+    audio_cushion *c = &plugin->cushion;
+    c->jitter += audio_chunk_ns(plugin);
+    c->last_pickup = 0;
+    plugin->drift.out_start = 0;
+    audio_cushion_update(plugin);
+}
 
 static void *audio_thread(void *data) {
     droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
     dlog("audio_thread start");
+    apply_thread_policy("audio thread", &plugin->audio_policy, "Pro Audio");
+    os_set_thread_name("droidcam-audio");
 
     int waiting = 0;
-    while ((os_event_timedwait(plugin->stop_signal, 5) != 0) && (plugin->pAudioData))
+    uint64_t written_ns = 0, written_pts = 0;
+    int written_frames = 0;
+    while (plugin->pAudioData)
     {
+        audio_thread_wait(plugin);
+        if (os_event_try(plugin->stop_signal) != EAGAIN)
+            break;
+
+        if (plugin->cushion.reset.exchange(false, std::memory_order_acquire)) {
+            audio_cushion_reset(plugin);
+            waiting = 1;
+            written_ns = 0;
+        }
+
         if (!plugin->have_audio) {
-            if (!waiting) waiting = 1;
+            waiting = 1;
+            written_ns = 0;
+            continue;
+        }
+
+        note_cpu(&plugin->audio_cpus);
+        if (plugin->pAudioHeader->data_valid)
             continue;
+
+        // the consumer took the last chunk since we looked
+        if (written_ns) {
+            const uint64_t now = os_gettime_ns();
+            plugin->latency.stage[LAT_AUDIO_PICKUP].record(written_ns, now);
+            plugin->latency.stage[LAT_AUDIO_TOTAL].record(written_pts, now);
+            audio_cushion_pickup(plugin, now);
+            audio_drift_pickup(plugin, now, written_frames);
+            written_ns = 0;
         }
 
         if (waiting) {
-            if (plugin->audioDataQueue.readyQueue.size() < AUDIO_CUSHION)
+            if ((int) plugin->audioRing.size() < plugin->cushion.chunks.load(std::memory_order_relaxed))
                 continue;
 
             waiting = 0;
         }
-        else {
-            if (plugin->audioDataQueue.readyQueue.size() == 0)
-                waiting = 1;
-        }
-
-        if (plugin->pAudioHeader->data_valid)
-            continue;
 
-        plugin->audioDataQueue.lock();
-        DataPacket *packet = plugin->audioDataQueue.pull_ready_packet();
+        DataPacket *packet = plugin->audioRing.read_slot();
         if (packet) {
             memcpy(plugin->pAudioData, packet->data, packet->used);
+            written_frames = packet->frames;
+            plugin->pAudioHeader->frames = written_frames;
+            plugin->pAudioHeader->pts = (long long) packet->pts;
             plugin->pAudioHeader->data_valid = 1;
-            plugin->audioDataQueue.push_empty_packet(packet);
+            written_ns = os_gettime_ns();
+            written_pts = packet->pts;
+            plugin->latency.stage[LAT_AUDIO_RING].record(packet->queued, written_ns);
+            plugin->audioRing.release();
         } else {
-            dlog("missed frame");
+            dlog("audio underrun");
+            audio_cushion_underrun(plugin);
+            waiting = 1;
         }
-        plugin->audioDataQueue.unlock();
     }
 
+    ResetThreadRealtime();
     dlog("audio_thread end");
     return 0;
 }
 
-static void video_conversion(droidcam_output_plugin *plugin) {
+// Formats the consumer can ask for, anything else gets YUY2
+static inline unsigned to_out_format(int format) {
+    switch ((unsigned) format) {
+    case FOURCC_UYVY:
+    case FOURCC_NV12:
+    case FOURCC_I420:
+        return (unsigned) format;
+    default:
+        return FOURCC_YUY2;
+    }
+}
+
+static inline enum video_format to_video_format(unsigned fourcc) {
+    switch (fourcc) {
+    case FOURCC_UYVY: return VIDEO_FORMAT_UYVY;
+    case FOURCC_NV12: return VIDEO_FORMAT_NV12;
+    case FOURCC_I420: return VIDEO_FORMAT_I420;
+    default:          return VIDEO_FORMAT_YUY2;
+    }
+}
+
+// Pick what libobs hands us for the current size and output format:
+//  - the output format itself when that needs no scaling on our side
+//    (planar output, or OBS already rendering the packed format):
+//    each frame is then a plain copy
+//  - otherwise NV12 or I420, whichever OBS renders, converted and
+//    scaled by us while packing
+static void video_pipeline(droidcam_output_plugin *plugin, video_params *v) {
+    const enum video_format out = to_video_format(v->out_format);
+    const bool scaled = v->image_w != plugin->default_w
+        || v->image_h != plugin->default_h;
+
+    v->conv = plugin->video_conv;
+    v->fused_scale = false;
+    v->copy_frame = out == VIDEO_FORMAT_NV12 || out == VIDEO_FORMAT_I420
+        || (out == plugin->native_format && !scaled);
+
+    if (v->copy_frame) {
+        v->conv.format = out;
+    }
+    else {
+        v->conv.format = (plugin->native_format == VIDEO_FORMAT_NV12)
+            ? VIDEO_FORMAT_NV12 : VIDEO_FORMAT_I420;
+
+        if (scaled && yuyv_scaler_init(&v->scaler,
+                plugin->default_w, plugin->default_h, v->image_w, v->image_h)) {
+            ilog("video scaling in plugin, horizontal %s/%s",
+                yuyv_scale_mode_name(v->scaler.x_luma.mode),
+                yuyv_scale_mode_name(v->scaler.x_chroma.mode));
+            v->fused_scale = true;
+        }
+    }
+
+    v->conv.width  = v->fused_scale ? plugin->default_w : v->image_w;
+    v->conv.height = v->fused_scale ? plugin->default_h : v->image_h;
+    v->gen = ++plugin->video_gen;
+    ilog("video output %.4s: %s from obs format %d", (const char *) &v->out_format,
+        v->copy_frame ? "copy" : "convert", (int) v->conv.format);
+}
+
+static void video_conversion(droidcam_output_plugin *plugin, video_params *v) {
     int shift_x, shift_y;
     int src_w = plugin->default_w;
     int src_h = plugin->default_h;
-    int dst_w = plugin->webcam_w;
-    int dst_h = plugin->webcam_h;
+    int dst_w = v->webcam_w;
+    int dst_h = v->webcam_h;
 
     if (src_w == dst_w && src_h == dst_h) {
-        plugin->shift_x = 0;
-        plugin->shift_y = 0;
-        plugin->video_conv.width = dst_w;
-        plugin->video_conv.height = dst_h;
+        v->shift_x = 0;
+        v->shift_y = 0;
+        v->image_w = dst_w;
+        v->image_h = dst_h;
+        video_pipeline(plugin, v);
         return;
     }
 
@@ -202,22 +693,165 @@ static void video_conversion(droidcam_output_plugin *plugin) {
 
     ilog("video scaling: %dx%d -> %dx%d inside %dx%d at %d,%d",
         src_w, src_h, dst_w, dst_h,
-        plugin->webcam_w, plugin->webcam_h,
+        v->webcam_w, v->webcam_h,
         shift_x, shift_y);
-    plugin->video_conv.width = dst_w;
-    plugin->video_conv.height = dst_h;
-    plugin->shift_x = shift_x;
-    plugin->shift_y = shift_y;
+    v->image_w = dst_w;
+    v->image_h = dst_h;
+    v->shift_x = shift_x;
+    v->shift_y = shift_y;
+    video_pipeline(plugin, v);
+}
+
+// Nothing in libobs has to change to go from one to the other
+static inline bool same_video_conv(const struct video_scale_info *a, const struct video_scale_info *b) {
+    return a->format == b->format && a->width == b->width && a->height == b->height;
+}
+
+static inline uint8_t *video_slot_data(droidcam_output_plugin *plugin, long slot) {
+    return plugin->pVideoData + (slot * VIDEO_SLOT_SIZE);
+}
+
+// Plane layout of a slot, see the FOURCC notes in structs.h
+struct slot_plane {
+    int bpp;            // bytes per pixel before subsampling
+    int sub_x, sub_y;   // chroma subsampling, as shifts
+};
+
+static int slot_layout(unsigned format, slot_plane planes[3]) {
+    switch (format) {
+    case FOURCC_NV12:
+        planes[0] = { 1, 0, 0 };
+        planes[1] = { 2, 1, 1 };
+        return 2;
+    case FOURCC_I420:
+        planes[0] = { 1, 0, 0 };
+        planes[1] = { 1, 1, 1 };
+        planes[2] = { 1, 1, 1 };
+        return 3;
+    default:
+        planes[0] = { 2, 0, 0 };
+        return 1;
+    }
+}
+
+// Black letterbox bars, the image area is written by every frame
+static void clear_video_slot(const video_params *v, uint8_t *dst) {
+    if (v->out_format == FOURCC_YUY2 || v->out_format == FOURCC_UYVY) {
+        clear_yuyv_borders(dst, v->webcam_w, v->webcam_h,
+            v->shift_x, v->shift_y,
+            v->image_w, v->image_h,
+            v->out_format == FOURCC_UYVY ? 0x00800080 : 0x80008000);
+        return;
+    }
+
+    slot_plane planes[3];
+    const int count = slot_layout(v->out_format, planes);
+    for (int i = 0; i < count; i++) {
+        const slot_plane &p = planes[i];
+        const int linesize = (v->webcam_w * p.bpp) >> p.sub_x;
+        const int rows = v->webcam_h >> p.sub_y;
+        clear_plane_borders(dst, linesize, linesize, rows,
+            (v->shift_x * p.bpp) >> p.sub_x, v->shift_y >> p.sub_y,
+            (v->image_w * p.bpp) >> p.sub_x, v->image_h >> p.sub_y,
+            i == 0 ? 0 : 0x80);
+        dst += linesize * rows;
+    }
+}
+
+// Consumers raise the control event after changing a header, the timeout
+// covers those that don't and ones that went away without clearing it.
+// Returns false once the output is stopping.
+static bool control_wait(droidcam_output_plugin *plugin) {
+    if (SharedEventValid(&plugin->controlEvent))
+        WaitSharedEvent(&plugin->controlEvent, CONTROL_POLL_MS);
+    else
+        os_event_timedwait(plugin->stop_signal, CONTROL_POLL_MS);
+
+    return os_event_try(plugin->stop_signal) == EAGAIN;
+}
+
+// end_data_capture finishes on an obs thread, which emits "deactivate"
+// right before the output stops being active. Returns false if the
+// output is stopping.
+static bool end_capture_wait(droidcam_output_plugin *plugin) {
+    os_event_reset(plugin->capture_stopped);
+    obs_output_end_data_capture(plugin->output);
+
+    while (obs_output_active(plugin->output)) {
+        if (os_event_try(plugin->stop_signal) != EAGAIN)
+            return false;
+
+        if (os_event_timedwait(plugin->capture_stopped, CAPTURE_STOP_MS) == 0)
+            os_sleep_ms(0);
+    }
+
+    return true;
+}
+
+static void on_deactivate(void *data, calldata_t *cd) {
+    droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
+    os_event_signal(plugin->capture_stopped);
+    UNUSED_PARAMETER(cd);
+}
+
+// Where the plugin threads actually ran since they started, to check
+// the configured pinning against what the scheduler did
+static void log_thread_cpus(droidcam_output_plugin *plugin) {
+    char audio[64], control[64], workers[128];
+    size_t len = 0;
+    workers[0] = 0;
+
+    WorkerPool *pool = plugin->workers;
+    for (int i = 0; i < pool->count && len < sizeof(workers) - 1; i++) {
+        char cpus[64];
+        int n = snprintf(workers + len, sizeof(workers) - len, "%s%s",
+            i ? " " : "", format_cpus(cpus, sizeof(cpus), pool->cpus[i]));
+        if (n < 0)
+            break;
+
+        len += n;
+    }
+
+    ilog("threads ran on cpus: audio %s, control %s, workers %s",
+        format_cpus(audio, sizeof(audio), plugin->audio_cpus),
+        format_cpus(control, sizeof(control), plugin->control_cpus),
+        len ? workers : "none");
 }
 
 static void *control_thread(void *data) {
     droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
     dlog("control_thread start");
+    apply_thread_policy("control thread", &plugin->control_policy, "Capture");
+    os_set_thread_name("droidcam-control");
 
     volatile VideoHeader *vh = plugin->pVideoHeader;
     volatile AudioHeader *ah = plugin->pAudioHeader;
-
-    while (os_event_timedwait(plugin->stop_signal, 999) != 0) {
+    bool short_map_logged = false;
+
+    do {
+        note_cpu(&plugin->control_cpus);
+        if (os_gettime_ns() - plugin->latency.last_ns >= LATENCY_DUMP_SEC * (uint64_t) RefTime::NANO_SEC) {
+            latency_stats_dump(&plugin->latency);
+            log_thread_cpus(plugin);
+            if (plugin->pacing.converted.load(std::memory_order_relaxed))
+                ilog("video pacing: converted %llu, skipped %llu, duplicated %llu",
+                    (unsigned long long) plugin->pacing.converted.load(std::memory_order_relaxed),
+                    (unsigned long long) plugin->pacing.skipped.load(std::memory_order_relaxed),
+                    (unsigned long long) plugin->pacing.duplicated.load(std::memory_order_relaxed));
+            if (plugin->have_audio) {
+                const audio_drift *d = &plugin->drift;
+                const double ms = 1000.0 / plugin->audio_conv.samples_per_sec;
+                const double target = d->target.load(std::memory_order_relaxed);
+                ilog("audio cushion: %d x %d frames, queue %.1f ms (target %.1f), drift %+.1f ppm, dropped %llu, underruns %llu",
+                    plugin->cushion.chunks.load(std::memory_order_relaxed),
+                    plugin->cushion.chunk_frames.load(std::memory_order_relaxed),
+                    d->occupancy.load(std::memory_order_relaxed) * ms,
+                    target < 0 ? 0.0 : target * ms,
+                    d->ppm.load(std::memory_order_relaxed),
+                    (unsigned long long) plugin->audioRing.overruns.load(),
+                    (unsigned long long) plugin->audioRing.underruns.load());
+            }
+        }
 
         bool have_video =
             vh->info.control == CONTROL
@@ -228,35 +862,56 @@ static void *control_thread(void *data) {
             ah->info.control == CONTROL
             && ah->info.checksum == (ah->info.sample_rate ^ ah->info.channels);
 
-        //dlog("audio queue size: %d / %d",
-        //    (int) plugin->audioDataQueue.emptyQueue.size(),
-        //    (int) plugin->audioDataQueue.readyQueue.size());
+        dlog("audio ring: size=%d high=%d pushed=%llu popped=%llu overruns=%llu underruns=%llu",
+            (int) plugin->audioRing.size(),
+            (int) plugin->audioRing.high_water.load(),
+            (unsigned long long) plugin->audioRing.pushed.load(),
+            (unsigned long long) plugin->audioRing.popped.load(),
+            (unsigned long long) plugin->audioRing.overruns.load(),
+            (unsigned long long) plugin->audioRing.underruns.load());
 
         if (!have_video && !have_audio) {
             if (obs_output_active(plugin->output)) {
                 ilog("webcam became inactive");
-                obs_output_end_data_capture(plugin->output);
+                if (!end_capture_wait(plugin))
+                    break;
             }
 
             continue;
         }
 
+        const int cur_video = plugin->video_active.load(std::memory_order_relaxed);
+        const int cur_audio = plugin->audio_active.load(std::memory_order_relaxed);
+        const video_params *v = &plugin->video[cur_video];
+        const audio_params *a = &plugin->audio[cur_audio];
+
         int flags = 0;
         int webcam_w, webcam_h, webcam_interval;
+        unsigned webcam_format;
 
         int webcam_audio_rate;
+        int webcam_chunk_frames = DEF_FRAMES;
+        int webcam_sample_format = SAMPLE_FMT_S16;
         enum speaker_layout webcam_speaker_layout;
 
         if (have_video) {
             webcam_w = vh->info.width;
             webcam_h = vh->info.height;
             webcam_interval = vh->info.interval;
+            webcam_format = to_out_format(vh->info.format);
             flags |= OBS_OUTPUT_VIDEO;
+
+            // picked up by on_video, no need to restart capture for it
+            if (os_atomic_load_long(&plugin->pacing.interval) != webcam_interval) {
+                ilog("video pacing: consumer interval %d", webcam_interval);
+                os_atomic_set_long(&plugin->pacing.interval, webcam_interval);
+            }
         }
         else {
             webcam_w = plugin->default_w;
             webcam_h = plugin->default_h;
             webcam_interval = plugin->default_interval;
+            webcam_format = v->out_format;
         }
 
         if (have_audio) {
@@ -265,6 +920,13 @@ static void *control_thread(void *data) {
 
             if (webcam_speaker_layout != SPEAKERS_UNKNOWN) {
                 flags |= OBS_OUTPUT_AUDIO;
+                webcam_sample_format = to_sample_format(ah->sample_format);
+
+                const int max_frames = max_chunk_frames(
+                    audio_sample_bytes(webcam_sample_format) * ah->info.channels);
+                webcam_chunk_frames = ah->chunk_frames > 0 ? ah->chunk_frames : DEF_FRAMES;
+                if (webcam_chunk_frames < AUDIO_MIN_FRAMES) webcam_chunk_frames = AUDIO_MIN_FRAMES;
+                if (webcam_chunk_frames > max_frames) webcam_chunk_frames = max_frames;
             }
             else {
                 elog("WARN: unknown webcam speaker layout, channels=%d", ah->info.channels);
@@ -276,64 +938,138 @@ static void *control_thread(void *data) {
             webcam_speaker_layout = plugin->default_speaker_layout;
         }
 
+        // consumers opt in to triple buffering, see VideoFrameRing.
+        // A mapping the driver made first keeps its own size, one slot
+        // is all an old one has room for.
+        int video_slots = 1;
+        if (vh->ring.frame_slots == VIDEO_FRAME_SLOTS) {
+            if (plugin->videoMem.size >= VIDEO_MAP_SIZE) {
+                video_slots = VIDEO_FRAME_SLOTS;
+            } else if (!short_map_logged) {
+                elog("WARN: video mapping is %llu bytes, %llu needed for %d frame slots, using one",
+                    (unsigned long long) plugin->videoMem.size,
+                    (unsigned long long) VIDEO_MAP_SIZE, VIDEO_FRAME_SLOTS);
+                short_map_logged = true;
+            }
+        }
+
         const bool video_ok =
-            (webcam_w - plugin->shift_x - plugin->shift_x - plugin->video_conv.width <= 4) &&
-            (webcam_h - plugin->shift_y - plugin->shift_y - plugin->video_conv.height <= 4);
+            ((unsigned)(webcam_w - v->shift_x - v->shift_x - v->image_w) <= 4) &&
+            ((unsigned)(webcam_h - v->shift_y - v->shift_y - v->image_h) <= 4) &&
+            (v->out_format == webcam_format) &&
+            (!have_video || v->slots == video_slots);
 
-        const bool audio_ok =
+        const bool audio_conv_ok =
             plugin->audio_conv.speakers == webcam_speaker_layout &&
-            plugin->audio_conv.samples_per_sec == webcam_audio_rate;
+            (int) plugin->audio_conv.samples_per_sec == webcam_audio_rate;
 
-        if (obs_output_active(plugin->output)) {
-            if (audio_ok && video_ok)
-                continue;
+        const bool audio_ok = audio_conv_ok &&
+            a->chunk_frames == webcam_chunk_frames &&
+            a->sample_format == webcam_sample_format;
 
-            dlog("output conversion needs to be updated");
-            obs_output_end_data_capture(plugin->output);
+        const bool active = obs_output_active(plugin->output);
+        if (active && audio_ok && video_ok)
+            continue;
 
-            // todo: this can probably be improved..
-            while (obs_output_active(plugin->output)) {
-                os_sleep_ms(5);
-                if (os_event_try(plugin->stop_signal) != EAGAIN)
-                    return 0;
-            }
+        // New sizes and formats are switched to between two frames while
+        // libobs keeps delivering the same thing. Capture is restarted when
+        // that has to change, or when the spare copy is still unclaimed.
+        bool restart = !active || !audio_conv_ok
+            || plugin->have_video != have_video || plugin->have_audio != have_audio
+            || (!video_ok && plugin->video_seen.load(std::memory_order_acquire) != cur_video)
+            || (!audio_ok && plugin->audio_seen.load(std::memory_order_acquire) != cur_audio);
+
+        if (restart && active) {
+            dlog("output conversion needs to be updated");
+            if (!end_capture_wait(plugin))
+                break;
         }
 
         if (have_video)
-            ilog("webcam video active %dx%d %dfps, video_ok=%d",
+            ilog("webcam video active %dx%d %dfps %.4s, %d slot(s), video_ok=%d",
                 webcam_w, webcam_h,
                 (int)(RefTime::UNITS / webcam_interval),
-                (int) video_ok);
+                (const char *) &webcam_format,
+                video_slots, (int) video_ok);
 
         if (have_audio)
-            ilog("webcam audio active %d Hz %d channels, audio_ok=%d",
-                webcam_audio_rate, webcam_speaker_layout, (int) audio_ok);
+            ilog("webcam audio active %d Hz %d channels, format %d, %d frame chunks, audio_ok=%d",
+                webcam_audio_rate, to_channels(webcam_speaker_layout), webcam_sample_format,
+                webcam_chunk_frames, (int) audio_ok);
 
         if (!video_ok) {
-            plugin->webcam_w = webcam_w;
-            plugin->webcam_h = webcam_h;
-            video_conversion(plugin);
-            plugin->is_aligned_128b = (plugin->video_conv.width % 16 == 0);
-            obs_output_set_video_conversion(plugin->output, &plugin->video_conv);
+            video_params *nv = &plugin->video[cur_video ^ 1];
+            nv->webcam_w = webcam_w;
+            nv->webcam_h = webcam_h;
+            nv->out_format = webcam_format;
+            nv->slots = video_slots;
+            video_conversion(plugin, nv);
+
+            if (!restart && !same_video_conv(&nv->conv, &plugin->video_conv)) {
+                dlog("obs video conversion needs to be updated");
+                restart = true;
+                if (!end_capture_wait(plugin))
+                    break;
+            }
+
+            plugin->video_active.store(cur_video ^ 1, std::memory_order_seq_cst);
+            v = nv;
         }
 
         if (!audio_ok) {
-            plugin->audio_frame_size_bytes = (SAMPLE_BITS/8) * to_channels(webcam_speaker_layout);
+            audio_params *na = &plugin->audio[cur_audio ^ 1];
+            na->frame_size_bytes = audio_sample_bytes(webcam_sample_format)
+                * to_channels(webcam_speaker_layout);
+            na->sample_format = webcam_sample_format;
+            na->chunk_frames = webcam_chunk_frames;
+            plugin->audio_active.store(cur_audio ^ 1, std::memory_order_release);
+            a = na;
+        }
+
+        if (!restart) {
+            // frames already published may be of the old size, on_video
+            // takes back one it publishes across the flip
+            if (!video_ok)
+                os_atomic_set_long(&vh->ring.latest, -1);
+
+            ilog("webcam output switched without restarting capture");
+            continue;
+        }
+
+        // nothing runs on_video / on_audio until capture begins again
+        plugin->video_seen.store(plugin->video_active.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        plugin->audio_seen.store(plugin->audio_active.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+        if (!same_video_conv(&v->conv, &plugin->video_conv)) {
+            plugin->video_conv = v->conv;
+            obs_output_set_video_conversion(plugin->output, &plugin->video_conv);
+        }
+
+        if (!audio_conv_ok) {
             plugin->audio_conv.speakers = webcam_speaker_layout;
             plugin->audio_conv.samples_per_sec = webcam_audio_rate;
             obs_output_set_audio_conversion(plugin->output, &plugin->audio_conv);
         }
 
+        if (have_video) {
+            plugin->pacing.next_due = 0;
+            os_atomic_set_long(&vh->ring.latest, -1);
+        }
+
         plugin->have_video = have_video;
         plugin->have_audio = have_audio;
-        plugin->audioDataQueue.lock();
-        plugin->audioDataQueue.clear();
-        plugin->audioDataQueue.unlock();
-        memset(plugin->pAudioData, 0, AUDIO_DATA_SIZE * CHUNKS_COUNT);
-        clear_yuyv(plugin->pVideoData, MAX_WIDTH*MAX_HEIGHT*2, 0x80008000);
+        plugin->audioRing.flush();
+        plugin->audio_fill = NULL;
+        plugin->drift.in_start = 0;
+        resampler_init(&plugin->drift.rs, to_channels(plugin->audio_conv.speakers));
+        plugin->cushion.chunk_frames.store(a->chunk_frames, std::memory_order_relaxed);
+        plugin->cushion.reset.store(true, std::memory_order_release);
+        memset(plugin->pAudioData, 0, AUDIO_CHUNK_BYTES);
+        memset(plugin->slot_gen, 0, sizeof(plugin->slot_gen));
         obs_output_begin_data_capture(plugin->output, 0);
-    }
+    } while (control_wait(plugin));
 
+    ResetThreadRealtime();
     dlog("control_thread end");
     return 0;
 }
@@ -342,6 +1078,11 @@ static void output_stop(void *data, uint64_t ts) {
     droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
     dlog("output_stop");
     os_event_signal(plugin->stop_signal);
+    os_event_signal(plugin->capture_stopped);
+    if (SharedEventValid(&plugin->audioEvent))
+        SetSharedEvent(&plugin->audioEvent);
+    if (SharedEventValid(&plugin->controlEvent))
+        SetSharedEvent(&plugin->controlEvent);
     pthread_join(plugin->audio_thread, NULL);
     pthread_join(plugin->control_thread, NULL);
     obs_output_end_data_capture(plugin->output);
@@ -351,7 +1092,7 @@ static void output_stop(void *data, uint64_t ts) {
 
 static bool output_start(void *data) {
     droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
-    if (!(plugin->pVideoMem && plugin->pAudioMem)) {
+    if (!(plugin->videoMem.mem && plugin->audioMem.mem && plugin->audioRing.storage)) {
         elog("Cannot start without memory mapping !! ");
         return false;
     }
@@ -378,16 +1119,28 @@ static bool output_start(void *data) {
         elog("output format mismatch !!");
     #endif
 
+    video_params *v = &plugin->video[0];
     plugin->have_video = false;
-    plugin->shift_x = 0;
-    plugin->shift_y = 0;
+    plugin->native_format = (enum video_format) format;
     plugin->default_w = width;
     plugin->default_h = height;
     plugin->default_interval = interval;
-    plugin->video_conv.format = VIDEO_FORMAT_I420;
-    plugin->video_conv.width  = width;
-    plugin->video_conv.height = height;
-    plugin->is_aligned_128b = (width % 16 == 0);
+    v->slots = 1;
+    v->shift_x = 0;
+    v->shift_y = 0;
+    v->image_w = width;
+    v->image_h = height;
+    v->out_format = FOURCC_YUY2;
+    v->webcam_w = width;
+    v->webcam_h = height;
+    video_pipeline(plugin, v);
+    plugin->video_active.store(0, std::memory_order_relaxed);
+    plugin->video_seen.store(0, std::memory_order_relaxed);
+    memset(plugin->slot_gen, 0, sizeof(plugin->slot_gen));
+    plugin->pacing.interval = 0;
+    plugin->pacing.obs_interval_ns = (uint64_t) interval * 100;
+    plugin->pacing.next_due = 0;
+    plugin->video_conv = v->conv;
     obs_output_set_video_conversion(plugin->output, &plugin->video_conv);
 
     audio_t *audio = obs_output_audio(plugin->output);
@@ -398,13 +1151,25 @@ static bool output_start(void *data) {
     plugin->have_audio = false;
     plugin->default_sample_rate = sample_rate;
     plugin->default_speaker_layout = to_speaker_layout(channels);
-    plugin->audio_frame_size_bytes = (SAMPLE_BITS/8) * channels;
+    audio_params *a = &plugin->audio[0];
+    a->sample_format = SAMPLE_FMT_S16;
+    a->frame_size_bytes = audio_sample_bytes(SAMPLE_FMT_S16) * channels;
+    a->chunk_frames = max_chunk_frames(a->frame_size_bytes);
+    plugin->audio_active.store(0, std::memory_order_relaxed);
+    plugin->audio_seen.store(0, std::memory_order_relaxed);
+    plugin->cushion.chunk_frames.store(a->chunk_frames, std::memory_order_relaxed);
+    plugin->audio_fill = NULL;
+    plugin->drift.in_start = 0;
+    resampler_init(&plugin->drift.rs, channels);
     plugin->audio_conv.format = OBS_AUDIO_FMT;
     plugin->audio_conv.samples_per_sec = sample_rate;
     plugin->audio_conv.speakers = plugin->default_speaker_layout;
     obs_output_set_audio_conversion(plugin->output, &plugin->audio_conv);
 
+    plugin->cushion.reset.store(true, std::memory_order_relaxed);
     os_event_reset(plugin->stop_signal);
+    plugin->audio_cpus = 0;
+    plugin->control_cpus = 0;
     pthread_create(&plugin->audio_thread, NULL, audio_thread, plugin);
     pthread_create(&plugin->control_thread, NULL, control_thread, plugin);
     return true;
@@ -419,115 +1184,499 @@ static void output_destroy(void *data) {
             output_stop(data, 0);
         }
 
-        #ifdef _WIN32
         plugin->pVideoData = NULL;
         plugin->pVideoHeader = NULL;
-        if (plugin->pVideoMem) {
+        if (plugin->videoMem.mem) {
             ilog("closing shared memory [video]");
-            UnmapViewOfFile(plugin->pVideoMem);
-            CloseHandle(plugin->hVideoMapping);
+            CloseSharedMem(&plugin->videoMem);
         }
 
         plugin->pAudioData = NULL;
         plugin->pAudioHeader = NULL;
-        if (plugin->pAudioMem) {
+        if (plugin->audioMem.mem) {
             ilog("closing shared memory [audio]");
-            UnmapViewOfFile(plugin->pAudioMem);
-            CloseHandle(plugin->hAudioMapping);
+            CloseSharedMem(&plugin->audioMem);
         }
 
-        if (plugin->hVideoWrLock) CloseHandle(plugin->hVideoWrLock);
-        if (plugin->hVideoRdLock) CloseHandle(plugin->hVideoRdLock);
-        #endif
+        if (SharedEventValid(&plugin->videoWrLock)) CloseSharedEvent(&plugin->videoWrLock);
+        if (SharedEventValid(&plugin->videoRdLock)) CloseSharedEvent(&plugin->videoRdLock);
+        if (SharedEventValid(&plugin->audioEvent)) CloseSharedEvent(&plugin->audioEvent);
+        if (SharedEventValid(&plugin->controlEvent)) CloseSharedEvent(&plugin->controlEvent);
+
+        signal_handler_disconnect(obs_output_get_signal_handler(plugin->output),
+            "deactivate", on_deactivate, plugin);
+
+        shared_release(plugin);
+        yuyv_scaler_free(&plugin->video[0].scaler);
+        yuyv_scaler_free(&plugin->video[1].scaler);
 
         os_event_destroy(plugin->stop_signal);
+        os_event_destroy(plugin->capture_stopped);
         delete plugin;
         ilog("plugin destroyed");
     }
 }
 
+// Thread placement settings, with their profile config keys for the
+// Tools menu output. *_cpu -1 = not pinned, *_priority 0 = normal
+// scheduling, 1..99 = real time. The first output sets up the shared
+// workers, later outputs' worker_* settings have no effect.
+static const struct {
+    const char *setting;
+    const char *config;
+    int def;
+} thread_settings[] = {
+    { "audio_cpu",        "AudioCpu",        -1 },
+    { "audio_priority",   "AudioPriority",    0 },
+    { "control_cpu",      "ControlCpu",      -1 },
+    { "control_priority", "ControlPriority",  0 },
+    { "worker_cpu",       "WorkerCpu",       -1 },
+    { "worker_priority",  "WorkerPriority",   0 },
+    { "rt_round_robin",   "RealtimeRoundRobin", 0 },
+};
+
+static thread_policy read_thread_policy(obs_data_t *settings, const char *thread) {
+    char key[32];
+    thread_policy policy;
+
+    snprintf(key, sizeof(key), "%s_cpu", thread);
+    policy.cpu = (int) obs_data_get_int(settings, key);
+    snprintf(key, sizeof(key), "%s_priority", thread);
+    policy.priority = (int) obs_data_get_int(settings, key);
+    policy.round_robin = obs_data_get_int(settings, "rt_round_robin") != 0;
+
+    if (policy.cpu >= 0 || policy.priority > 0)
+        ilog("%s threads: cpu %d, priority %d%s", thread, policy.cpu, policy.priority,
+            policy.priority > 0 && policy.round_robin ? " (round robin)" : "");
+
+    return policy;
+}
+
 static void *output_create(obs_data_t *settings, obs_output_t *output) {
-    ilog("output_create: %p r%s", output, PluginVer);
     droidcam_output_plugin *plugin = new droidcam_output_plugin();
+    plugin->instance = (int) obs_data_get_int(settings, "instance");
+    ilog("output_create: %p instance %d r%s", output, plugin->instance, PluginVer);
+
     plugin->output = output;
     os_event_init(&plugin->stop_signal, OS_EVENT_TYPE_MANUAL);
-
-#ifdef _WIN32
+    os_event_init(&plugin->capture_stopped, OS_EVENT_TYPE_MANUAL);
+    signal_handler_connect(obs_output_get_signal_handler(output),
+        "deactivate", on_deactivate, plugin);
+
+    plugin->audio_policy = read_thread_policy(settings, "audio");
+    plugin->control_policy = read_thread_policy(settings, "control");
+    plugin->worker_policy = read_thread_policy(settings, "worker");
+    plugin->avx512 = obs_data_get_bool(settings, "avx512");
+    shared_acquire(plugin);
+    if (plugin->instance < 0)
+        return plugin;
+
+    char buf[64];
+    const int instance = plugin->instance;
+    const int shm_flags = obs_data_get_bool(settings, "large_pages")
+        ? SHM_LARGE_PAGES | SHM_LOCKED : 0;
+    if (shm_flags)
+        ilog("using large, locked pages for the shared memory");
 {
-    const LPCWSTR name = VIDEO_MAP_NAME;
-    DWORD size = VIDEO_MAP_SIZE;
+    const char *name = instance_name(buf, sizeof(buf), VIDEO_MAP_NAME, instance);
+    size_t size = VIDEO_MAP_SIZE;
     ALIGN_SIZE(size, ALIGNMENT);
 
-    if (CreateSharedMem(&plugin->hVideoMapping, &plugin->pVideoMem, name, size)) {
-        ilog("mapped %8d bytes @ %p [video]", size, plugin->pVideoMem);
-        plugin->pVideoHeader = (VideoHeader *) plugin->pVideoMem;
-        plugin->pVideoData   = (BYTE*)(plugin->pVideoHeader + 1);
+    if (CreateSharedMem(&plugin->videoMem, name, size, shm_flags)) {
+        ilog("mapped %8d bytes @ %p [%s]", (int) plugin->videoMem.size, plugin->videoMem.mem, name);
+        plugin->pVideoHeader = (VideoHeader *) plugin->videoMem.mem;
+        plugin->pVideoData   = (uint8_t*)(plugin->pVideoHeader + 1);
     }
 
-    plugin->hVideoWrLock = CreateEventW( NULL, TRUE, TRUE, VIDEO_WR_LOCK_NAME );
-    plugin->hVideoRdLock = CreateEventW( NULL, TRUE, TRUE, VIDEO_RD_LOCK_NAME );
+    CreateSharedEvent(&plugin->videoWrLock,
+        instance_name(buf, sizeof(buf), VIDEO_WR_LOCK_NAME, instance), true, true);
+    CreateSharedEvent(&plugin->videoRdLock,
+        instance_name(buf, sizeof(buf), VIDEO_RD_LOCK_NAME, instance), true, true);
 }
 {
-    const LPCWSTR name = AUDIO_MAP_NAME;
-    DWORD size = AUDIO_MAP_SIZE;
+    const char *name = instance_name(buf, sizeof(buf), AUDIO_MAP_NAME, instance);
+    size_t size = AUDIO_MAP_SIZE;
     ALIGN_SIZE(size, ALIGNMENT);
 
-    if (CreateSharedMem(&plugin->hAudioMapping, &plugin->pAudioMem, name, size)) {
-        ilog("mapped %8d bytes @ %p [audio]", size, plugin->pAudioMem);
-        plugin->pAudioHeader = (AudioHeader *) plugin->pAudioMem;
-        plugin->pAudioData   = (BYTE*)plugin->pAudioMem + sizeof(AudioHeader);
+    if (CreateSharedMem(&plugin->audioMem, name, size, shm_flags)) {
+        ilog("mapped %8d bytes @ %p [%s]", (int) plugin->audioMem.size, plugin->audioMem.mem, name);
+        plugin->pAudioHeader = (AudioHeader *) plugin->audioMem.mem;
+        plugin->pAudioData   = plugin->audioMem.mem + sizeof(AudioHeader);
     }
+
+    CreateSharedEvent(&plugin->audioEvent,
+        instance_name(buf, sizeof(buf), AUDIO_RD_EVENT_NAME, instance), false, false);
+
+    if (!plugin->audioRing.init(AUDIO_CHUNK_BYTES))
+        elog("could not allocate the audio ring");
 }
-#endif // _WIN32
 
-    UNUSED_PARAMETER(settings);
+    CreateSharedEvent(&plugin->controlEvent,
+        instance_name(buf, sizeof(buf), CONTROL_EVENT_NAME, instance), false, false);
     return plugin;
 }
 
+static void output_defaults(obs_data_t *settings) {
+    obs_data_set_default_int(settings, "instance", 0);
+    obs_data_set_default_bool(settings, "large_pages", false);
+    obs_data_set_default_bool(settings, "avx512", false);
+    for (size_t i = 0; i < ARRAY_LEN(thread_settings); i++)
+        obs_data_set_default_int(settings, thread_settings[i].setting, thread_settings[i].def);
+}
+
+struct video_band_job {
+    const video_params *v;
+    struct video_data *frame;
+    uint8_t *dst;
+};
+
+// Frames already in the output format, row by row into the slot planes
+static void copy_band(const video_params *v, struct video_data *frame,
+    uint8_t *dst, int row_start, int row_end)
+{
+    slot_plane planes[3];
+    const int count = slot_layout(v->out_format, planes);
+
+    size_t frame_bytes = 0;
+    for (int i = 0; i < count; i++)
+        frame_bytes += (size_t) ((v->webcam_w * planes[i].bpp) >> planes[i].sub_x)
+            * (v->webcam_h >> planes[i].sub_y);
+    const int stream = yuyv_use_stream(frame_bytes);
+
+    for (int i = 0; i < count; i++) {
+        const slot_plane &p = planes[i];
+        const int linesize = (v->webcam_w * p.bpp) >> p.sub_x;
+        const int r0 = row_start >> p.sub_y;
+        const int r1 = (row_end + (1 << p.sub_y) - 1) >> p.sub_y;
+
+        uint8_t *plane = dst + ((v->shift_y >> p.sub_y) + r0) * linesize
+            + ((v->shift_x * p.bpp) >> p.sub_x);
+        copy_plane_rows(plane, linesize,
+            frame->data[i] + r0 * frame->linesize[i], frame->linesize[i],
+            (v->image_w * p.bpp) >> p.sub_x, r1 - r0, stream);
+
+        dst += linesize * (v->webcam_h >> p.sub_y);
+    }
+}
+
+static void convert_band(void *arg, int band, int bands) {
+    video_band_job *job = reinterpret_cast<video_band_job *>(arg);
+    const video_params *v = job->v;
+
+    // split on row pairs, 4:2:0 chroma rows are shared by two luma rows
+    const int pairs = v->image_h >> 1;
+    const int row_start = (pairs * band / bands) << 1;
+    const int row_end = (band == bands - 1) ? v->image_h : (pairs * (band + 1) / bands) << 1;
+
+    if (v->copy_frame) {
+        copy_band(v, job->frame, job->dst, row_start, row_end);
+        return;
+    }
+
+    // [nv12][uyvy]
+    static decltype(&scale_yuv420_yuyv_rows) const scale_rows[2][2] = {
+        { scale_yuv420_yuyv_rows, scale_yuv420_uyvy_rows },
+        { scale_nv12_yuyv_rows,   scale_nv12_uyvy_rows },
+    };
+    static decltype(&map_yuv420_yuyv_rows) const map_rows[2][2] = {
+        { map_yuv420_yuyv_rows, map_yuv420_uyvy_rows },
+        { map_nv12_yuyv_rows,   map_nv12_uyvy_rows },
+    };
+
+    const int nv12 = v->conv.format == VIDEO_FORMAT_NV12;
+    const int uyvy = v->out_format == FOURCC_UYVY;
+    if (v->fused_scale)
+        scale_rows[nv12][uyvy](&v->scaler,
+            job->frame->data, job->frame->linesize, job->dst,
+            v->shift_x, v->shift_y,
+            v->webcam_w, v->webcam_h,
+            row_start, row_end);
+    else
+        map_rows[nv12][uyvy](
+            job->frame->data, job->frame->linesize, job->dst,
+            v->shift_x, v->shift_y,
+            v->webcam_w, v->webcam_h,
+            v->image_w, v->image_h,
+            row_start, row_end);
+}
+
+// About one band per 720p worth of pixels, a single core keeps up below that.
+// When scaling, the source frame is what gets read.
+static inline int video_bands(const video_params *v) {
+    const int band_pixels = 1280 * 720;
+    int pixels = v->image_w * v->image_h;
+    if (v->fused_scale && pixels < (int) (v->conv.width * v->conv.height))
+        pixels = (int) (v->conv.width * v->conv.height);
+
+    const int bands = (pixels + band_pixels / 2) / band_pixels;
+    return bands > 1 ? bands : 1;
+}
+
+static void convert_frame(droidcam_output_plugin *plugin, const video_params *v,
+    struct video_data *frame, uint8_t *dst)
+{
+    video_band_job job = { v, frame, dst };
+    const int bands = video_bands(v);
+    if (plugin->workers->count && bands > 1)
+        worker_pool_run(plugin->workers, convert_band, &job, bands);
+    else
+        convert_band(&job, 0, 1);
+}
+
+// Any slot that is neither the newest frame nor being read
+static inline long next_video_slot(volatile VideoFrameRing *ring) {
+    const long latest  = os_atomic_load_long(&ring->latest);
+    const long reading = os_atomic_load_long(&ring->reading);
+    long slot = 0;
+    while (slot == latest || slot == reading)
+        slot++;
+
+    return slot;
+}
+
+// Advance the consumer clock past this frame, false if it will never be seen
+static bool video_frame_due(droidcam_output_plugin *plugin, uint64_t ts) {
+    video_pacing *p = &plugin->pacing;
+    const long interval = os_atomic_load_long(&p->interval);
+    if (interval <= 0 || p->obs_interval_ns == 0) {
+        p->converted.store(p->converted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const uint64_t step = (uint64_t) interval * 100;
+    const uint64_t half = p->obs_interval_ns / 2;
+    const uint64_t end = ts + half;
+
+    // first frame, new interval, or the timestamps jumped (OBS dropped
+    // frames or restarted the clock): restart the ticks at this frame
+    if (p->next_due == 0 || p->active_interval != interval
+        || p->next_due + step + half < ts || p->next_due > end + step)
+    {
+        p->active_interval = interval;
+        p->next_due = ts - half;
+    }
+
+    if (p->next_due >= end) {
+        p->skipped.store(p->skipped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const uint64_t ticks = (end - p->next_due + step - 1) / step;
+    p->next_due += ticks * step;
+
+    p->converted.store(p->converted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ticks > 1)
+        p->duplicated.store(p->duplicated.load(std::memory_order_relaxed) + ticks - 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+static inline void video_latency(droidcam_output_plugin *plugin, struct video_data *frame,
+    uint64_t entry_ns, uint64_t converted_ns, uint64_t published_ns)
+{
+    LatencyHistogram *stage = plugin->latency.stage;
+    stage[LAT_VIDEO_QUEUE].record(frame->timestamp, entry_ns);
+    stage[LAT_VIDEO_CONVERT].record(entry_ns, converted_ns);
+    stage[LAT_VIDEO_PUBLISH].record(converted_ns, published_ns);
+    stage[LAT_VIDEO_TOTAL].record(frame->timestamp, published_ns);
+}
+
+// The letterbox bars go in once per slot and size
+static inline void video_slot_borders(droidcam_output_plugin *plugin, const video_params *v,
+    long slot, uint8_t *dst)
+{
+    if (plugin->slot_gen[slot] != v->gen) {
+        plugin->slot_gen[slot] = v->gen;
+        clear_video_slot(v, dst);
+    }
+}
+
 static void on_video(void *data, struct video_data *frame) {
     droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
     if (plugin->have_video && plugin->pVideoData) {
-        #ifdef _WIN32
-        if (plugin->hVideoWrLock && plugin->hVideoRdLock) {
-            ResetEvent(plugin->hVideoWrLock);
-            if (WaitForSingleObject(plugin->hVideoRdLock, 5) == 0)
+        const uint64_t entry_ns = os_gettime_ns();
+        const int params = plugin->video_active.load(std::memory_order_acquire);
+        plugin->video_seen.store(params, std::memory_order_release);
+        const video_params *v = &plugin->video[params];
+
+        if (!video_frame_due(plugin, frame->timestamp))
+            return;
+
+        if (v->slots == VIDEO_FRAME_SLOTS) {
+            volatile VideoFrameRing *ring = &plugin->pVideoHeader->ring;
+            const long slot = next_video_slot(ring);
+            uint8_t *dst = video_slot_data(plugin, slot);
+
+            os_atomic_inc_long(&ring->slot_seq[slot]);
+            video_slot_borders(plugin, v, slot, dst);
+            convert_frame(plugin, v, frame, dst);
+            ring->slot_pts[slot] = (long long) frame->timestamp;
+            const uint64_t converted_ns = os_gettime_ns();
+            os_atomic_inc_long(&ring->slot_seq[slot]);
+
+            // the consumer has moved on to another size meanwhile
+            if (plugin->video_active.load(std::memory_order_seq_cst) != params)
+                return;
+
+            os_atomic_set_long(&ring->latest, slot);
+
+            // A switch between the check and the publish: the control thread
+            // flips video_active before it clears latest, so either its -1
+            // lands after our slot or we see the flip here and take it back
+            if (plugin->video_active.load(std::memory_order_seq_cst) != params) {
+                os_atomic_compare_swap_long(&ring->latest, slot, -1);
+                return;
+            }
+
+            os_atomic_inc_long(&ring->seq);
+            video_latency(plugin, frame, entry_ns, converted_ns, os_gettime_ns());
+        }
+        else if (SharedEventValid(&plugin->videoWrLock) && SharedEventValid(&plugin->videoRdLock)) {
+            // single buffer protocol, convert includes the wait for the reader
+            uint64_t converted_ns = 0;
+            ResetSharedEvent(&plugin->videoWrLock);
+            if (WaitSharedEvent(&plugin->videoRdLock, 5))
             {
-                uint8_t* dst = plugin->pVideoData;
-                map_yuv420_yuyv(frame->data, frame->linesize, dst,
-                    plugin->shift_x, plugin->shift_y,
-                    plugin->is_aligned_128b,
-                    plugin->webcam_w, plugin->webcam_h,
-                    plugin->video_conv.width, plugin->video_conv.height);
+                video_slot_borders(plugin, v, 0, plugin->pVideoData);
+                convert_frame(plugin, v, frame, plugin->pVideoData);
+                plugin->pVideoHeader->ring.slot_pts[0] = (long long) frame->timestamp;
+                converted_ns = os_gettime_ns();
             }
             else
             {
                 dlog("video lock fail/timeout: frame dropped");
             }
-            SetEvent(plugin->hVideoWrLock);
+            SetSharedEvent(&plugin->videoWrLock);
+            if (converted_ns)
+                video_latency(plugin, frame, entry_ns, converted_ns, os_gettime_ns());
+        }
+    }
+}
+
+// Append planar float frames to the ring in audio_chunk_frames chunks of
+// the consumer's format, a chunk left partly filled is completed by the
+// next call. pts is the time of the first frame. Returns true if a chunk
+// was completed.
+static bool audio_queue_frames(droidcam_output_plugin *plugin, const audio_params *a,
+    const float *const *planes, int frames, uint64_t pts, uint64_t entry_ns)
+{
+    const int frame_size = a->frame_size_bytes;
+    const int chunk_frames = a->chunk_frames;
+    const int channels = plugin->drift.rs.channels;
+    int offset = 0;
+    bool queued = false;
+
+    while (offset < frames) {
+        DataPacket *packet = plugin->audio_fill;
+        if (!packet) {
+            packet = plugin->audioRing.write_slot();
+            if (!packet)
+                break;
+
+            packet->pts = pts + (uint64_t) offset * RefTime::NANO_SEC / plugin->audio_conv.samples_per_sec;
+            plugin->audio_fill = packet;
+        }
+
+        const int filled = (int) (packet->used / frame_size);
+        const int n = (frames - offset < chunk_frames - filled) ? frames - offset : chunk_frames - filled;
+        audio_pack(packet->data + packet->used, a->sample_format,
+            planes, offset, n, channels);
+        packet->used += (size_t) n * frame_size;
+        offset += n;
+
+        if (filled + n == chunk_frames) {
+            packet->frames = chunk_frames;
+            packet->queued = entry_ns;
+            plugin->audioRing.commit();
+            plugin->audio_fill = NULL;
+            queued = true;
         }
-        #endif
     }
+
+    return queued;
+}
+
+// The consumer asked for other chunks. The queued ones are still good
+// when only the length changed, and the partly filled one goes out
+// short. In another sample format they are of no use to it.
+static void audio_params_switch(droidcam_output_plugin *plugin, int params) {
+    const audio_params *old = &plugin->audio[params ^ 1];
+    const audio_params *a = &plugin->audio[params];
+    DataPacket *packet = plugin->audio_fill;
+
+    if (old->sample_format != a->sample_format) {
+        plugin->audioRing.flush();
+    }
+    else if (packet && packet->used) {
+        packet->frames = (int) (packet->used / old->frame_size_bytes);
+        packet->queued = os_gettime_ns();
+        plugin->audioRing.commit();
+    }
+
+    plugin->audio_fill = NULL;
+    plugin->cushion.chunk_frames.store(a->chunk_frames, std::memory_order_relaxed);
+    plugin->audio_seen.store(params, std::memory_order_release);
 }
 
+// Packets of any size are resampled to the consumer clock, converted
+// and cut into chunks
 static void on_audio(void *data, struct audio_data *frame) {
     droidcam_output_plugin *plugin = reinterpret_cast<droidcam_output_plugin *>(data);
     if (plugin->have_audio) {
+        const uint64_t entry_ns = os_gettime_ns();
+        const int params = plugin->audio_active.load(std::memory_order_acquire);
+        if (params != plugin->audio_seen.load(std::memory_order_relaxed))
+            audio_params_switch(plugin, params);
+
+        const audio_params *a = &plugin->audio[params];
+        const int chunk_frames = a->chunk_frames;
+        const int channels = plugin->drift.rs.channels;
+        audio_cushion *c = &plugin->cushion;
+
+        if ((int) frame->frames > c->packet_frames.load(std::memory_order_relaxed))
+            c->packet_frames.store((int) frame->frames, std::memory_order_relaxed);
+
+        audio_drift_input(plugin, frame);
+
+        // Far past the cushion, the drift correction is not keeping up
+        // (or the consumer stalled). Drop the packet rather than let the
+        // latency grow.
+        const int limit = 2 * c->chunks.load(std::memory_order_relaxed)
+            + ((int) frame->frames + chunk_frames - 1) / chunk_frames;
+        if ((int) plugin->audioRing.size() >= limit) {
+            plugin->audioRing.drop();
+            return;
+        }
 
-        #ifdef _WIN32
-        if (plugin->audioDataQueue.readyQueue.size() < AUDIO_CUSHION) {
-            const int frames = frame->frames > DEF_FRAMES ? DEF_FRAMES : frame->frames;
-            const int size = frames * plugin->audio_frame_size_bytes;
+        float *scratch = shared_scratch_get();
+        if (!scratch)
+            return;
 
-            plugin->audioDataQueue.lock();
-            DataPacket *packet = plugin->audioDataQueue.pull_empty_packet(size);
-            memcpy(packet->data, frame->data[0], size);
-            packet->used = size;
-            // packet->pts = frame->timestamp;
-            plugin->audioDataQueue.push_ready_packet(packet);
-            plugin->audioDataQueue.unlock();
+        const uint64_t step = plugin->drift.step.load(std::memory_order_relaxed);
+        const float *in[MAX_CHANNELZ];
+        float *out[MAX_CHANNELZ];
+        for (int ch = 0; ch < channels; ch++)
+            out[ch] = scratch + ch * shared.scratch_stride;
+
+        uint64_t pts = frame->timestamp;
+        bool queued = false;
+        for (int done = 0; done < (int) frame->frames; ) {
+            const int n = ((int) frame->frames - done) > DEF_FRAMES ? DEF_FRAMES : (int) frame->frames - done;
+            for (int ch = 0; ch < channels; ch++)
+                in[ch] = (const float *) frame->data[ch] + done;
+
+            const int resampled = resample_f32(&plugin->drift.rs, in, n, out, step);
+            queued |= audio_queue_frames(plugin, a, out, resampled, pts, entry_ns);
+            pts += (uint64_t) resampled * RefTime::NANO_SEC / plugin->audio_conv.samples_per_sec;
+            done += n;
         }
-        #endif // _WIN32
+        shared_scratch_put(scratch);
 
+        plugin->latency.stage[LAT_AUDIO_QUEUE].record(frame->timestamp, entry_ns);
+
+        // wake the writer if the consumer slot is free
+        if (queued && !plugin->pAudioHeader->data_valid && SharedEventValid(&plugin->audioEvent))
+            SetSharedEvent(&plugin->audioEvent);
     }
 }
 
@@ -550,6 +1699,7 @@ bool obs_module_load(void) {
     droidcam_virtual_output_info.id       = "droidcam_virtual_output",
     droidcam_virtual_output_info.flags    = OBS_OUTPUT_AV,
     droidcam_virtual_output_info.get_name = output_getname,
+    droidcam_virtual_output_info.get_defaults = output_defaults,
     droidcam_virtual_output_info.create   = output_create,
     droidcam_virtual_output_info.destroy  = output_destroy,
     droidcam_virtual_output_info.start    = output_start,
@@ -558,6 +1708,10 @@ bool obs_module_load(void) {
     droidcam_virtual_output_info.raw_audio = on_audio,
     obs_register_output(&droidcam_virtual_output_info);
 
+    ilog("conversion using %s, streaming stores from %d KB frames (llc %d KB)",
+        yuyv_cpu_level_name(yuyv_cpu_init()),
+        (int) (yuyv_stream_threshold() >> 10), (int) (yuyv_llc_size() >> 10));
+
     #if DROIDCAM_OVERRIDE
 
     obs_data_t *obs_settings = obs_data_create();
@@ -570,6 +1724,11 @@ bool obs_module_load(void) {
 
     obs_config = obs_frontend_get_profile_config();
     config_set_default_bool(obs_config, "DroidCamVirtualOutput", "AutoStart", false);
+    config_set_default_bool(obs_config, "DroidCamVirtualOutput", "LargePages", false);
+    config_set_default_bool(obs_config, "DroidCamVirtualOutput", "Avx512", false);
+    for (size_t i = 0; i < ARRAY_LEN(thread_settings); i++)
+        config_set_default_int(obs_config, "DroidCamVirtualOutput",
+            thread_settings[i].config, thread_settings[i].def);
 
     QMainWindow *main_window = (QMainWindow *)obs_frontend_get_main_window();
     QAction *action = (QAction*)obs_frontend_add_tools_menu_qaction(PluginName);
@@ -583,6 +1742,13 @@ bool obs_module_load(void) {
     tools_menu_action->connect(tools_menu_action, &QAction::triggered, [=] (bool checked) {
         if (!droidcam_virtual_output) {
             obs_data_t *obs_settings = obs_data_create();
+            obs_data_set_bool(obs_settings, "large_pages",
+                config_get_bool(obs_config, "DroidCamVirtualOutput", "LargePages"));
+            obs_data_set_bool(obs_settings, "avx512",
+                config_get_bool(obs_config, "DroidCamVirtualOutput", "Avx512"));
+            for (size_t i = 0; i < ARRAY_LEN(thread_settings); i++)
+                obs_data_set_int(obs_settings, thread_settings[i].setting,
+                    config_get_int(obs_config, "DroidCamVirtualOutput", thread_settings[i].config));
             droidcam_virtual_output = obs_output_create(
                 "droidcam_virtual_output", "DroidCamVirtualOutput", obs_settings, NULL);
             ilog("droidcam_virtual_output=%p", droidcam_virtual_output);
@@ -15,16 +15,31 @@
 
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(a[0]))
 
+// Pin the calling thread to one logical cpu
+bool SetThreadAffinity(int cpu);
+
+// Real time scheduling for the calling thread, priority 1..99.
+// SCHED_FIFO (or SCHED_RR) on POSIX, which needs CAP_SYS_NICE or an
+// rtprio limit. The MMCSS `task` ("Pro Audio", "Capture") on windows.
+bool SetThreadRealtime(int priority, bool round_robin, const char *task);
 #ifdef _WIN32
-#define _WIN32_WINNT 0x0501
+// Leave the MMCSS task before the thread exits
+void ResetThreadRealtime(void);
+#else
+// Nothing to undo on POSIX, the policy goes away with the thread
+#define ResetThreadRealtime()
+#endif
+
+// Logical cpu the calling thread is on right now, -1 if unknown
+int GetCurrentCpu(void);
+
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0601
 #define _WIN32_IE    0x0500
 #define _WIN32_DCOM
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
-bool CreateSharedMem(LPHANDLE phFileMapping, LPVOID* ppSharedMem,
-    const LPCWSTR name, DWORD size);
-
 int GetRegValInt(const LPCWSTR path, const LPCWSTR entry);
 void SetRegValInt(const LPCWSTR path, const LPCWSTR entry, int data);
 #endif
@@ -1,99 +1,155 @@
 // Copyright (C) 2022 DEV47APPS, github.com/dev47apps
 #pragma once
 
-#include <vector>
-#include <mutex>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE 64
 
 struct DataPacket {
     uint8_t *data;
     size_t size;
     size_t used;
-    uint64_t pts;
+    uint64_t pts;     // OBS timestamp, ns
+    uint64_t queued;  // os_gettime_ns() when it entered the ring
+    int frames;       // audio frames in data
+};
+
+// Fixed capacity, wait-free single producer / single consumer ring.
+// All slots are allocated up front, so neither side ever takes a lock
+// or touches the allocator once init() is done.
+//
+// Producer: write_slot() -> fill -> commit()
+// Consumer: read_slot()  -> use  -> release()
+//
+// The counters are only written by the side that owns them
+// and can be read from any thread.
+template <size_t N>
+struct DataRing {
+    static_assert((N & (N - 1)) == 0, "ring size must be a power of two");
+
+    // producer side
+    alignas(CACHE_LINE) std::atomic<size_t> head;
+    size_t tail_cache;
+    std::atomic<uint64_t> pushed;
+    std::atomic<uint64_t> overruns;
+    std::atomic<size_t> high_water;
+
+    // consumer side
+    alignas(CACHE_LINE) std::atomic<size_t> tail;
+    size_t head_cache;
+    std::atomic<uint64_t> popped;
+    std::atomic<uint64_t> underruns;
+
+    // any thread -> consumer
+    alignas(CACHE_LINE) std::atomic<bool> flush_req;
+
+    DataPacket slots[N];
+    uint8_t *storage;
 
-    DataPacket(size_t new_size) {
-        size = 0;
-        data = 0;
-        resize(new_size);
+    DataRing(void) : head(0), tail_cache(0), pushed(0), overruns(0), high_water(0),
+        tail(0), head_cache(0), popped(0), underruns(0), flush_req(false), storage(0)
+    {
+        for (size_t i = 0; i < N; i++) {
+            slots[i].data = 0;
+            slots[i].size = 0;
+            slots[i].used = 0;
+            slots[i].pts  = 0;
+            slots[i].queued = 0;
+            slots[i].frames = 0;
+        }
     }
 
-    ~DataPacket(void) {
-        if (data) bfree(data);
+    ~DataRing(void) {
+        if (storage) bfree(storage);
     }
 
-    void resize(size_t new_size) {
-        if (size < new_size){
-            data = (uint8_t*) brealloc(data, new_size);
-            size = new_size;
+    bool init(size_t slot_size) {
+        slot_size = (slot_size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+        storage = (uint8_t*) bmalloc(slot_size * N);
+        if (!storage)
+            return false;
+
+        for (size_t i = 0; i < N; i++) {
+            slots[i].data = storage + (i * slot_size);
+            slots[i].size = slot_size;
         }
+        return true;
     }
-};
-
-struct DataQueue {
-    std::vector<DataPacket*> readyQueue;
-    std::vector<DataPacket*> emptyQueue;
-    size_t alloc_count;
-    std::mutex mutex;
 
-    inline void lock() { mutex.lock(); }
-    inline void unlock() { mutex.unlock(); }
+    static constexpr size_t capacity(void) { return N; }
 
-    DataQueue(void) {
-        alloc_count = 0;
+    // Occupancy, exact from either end, a snapshot from anywhere else
+    inline size_t size(void) const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
     }
 
-    void clear() {
-        DataPacket* packet;
-        while ((packet = pull_ready_packet()) != NULL) {
-            delete packet;
-            alloc_count --;
-        }
-        while ((packet = pull_empty_packet(0)) != NULL){
-            delete packet;
-            alloc_count --;
+    // -- producer
+
+    // Returns NULL when full
+    inline DataPacket *write_slot(void) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail_cache >= N) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (h - tail_cache >= N) {
+                overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return NULL;
+            }
         }
+
+        DataPacket *packet = &slots[h & (N - 1)];
+        packet->used = 0;
+        return packet;
     }
 
-    ~DataQueue(void) {
-        clear();
-        ilog("~alloc_count=%lu", alloc_count);
+    inline void commit(void) {
+        const size_t h = head.load(std::memory_order_relaxed) + 1;
+        head.store(h, std::memory_order_release);
+        pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        const size_t occupancy = h - tail_cache;
+        if (occupancy > high_water.load(std::memory_order_relaxed))
+            high_water.store(occupancy, std::memory_order_relaxed);
     }
 
-    inline DataPacket* pull_ready_packet(void) {
-        DataPacket* packet;
-        if (readyQueue.size()) {
-            packet = readyQueue.front();
-            readyQueue.erase(readyQueue.begin());
-        }
-        else {
-            packet = NULL;
-        }
-        return packet;
+    // Count a packet dropped before reaching the ring (eg. above the cushion)
+    inline void drop(void) {
+        overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     }
 
-    DataPacket* pull_empty_packet(size_t size) {
-        DataPacket* packet;
-        if (emptyQueue.size()) {
-            packet = emptyQueue.front();
-            emptyQueue.erase(emptyQueue.begin());
-            packet->resize(size);
-        }
-        else if (size) {
-            packet = new DataPacket(size);
-            ilog("alloc: size=%ld", size);
-            alloc_count ++;
+    // -- consumer
+
+    // Returns NULL when empty
+    inline DataPacket *read_slot(void) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (flush_req.load(std::memory_order_acquire)) {
+            flush_req.store(false, std::memory_order_relaxed);
+            t = head.load(std::memory_order_acquire);
+            tail.store(t, std::memory_order_release);
+            head_cache = t;
         }
-        else {
-            return NULL;
+
+        if (t == head_cache) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t == head_cache) {
+                underruns.store(underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return NULL;
+            }
         }
-        packet->used = 0;
-        return packet;
+
+        return &slots[t & (N - 1)];
     }
 
-    inline void push_empty_packet(DataPacket* packet) {
-        emptyQueue.push_back(packet);
+    inline void release(void) {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        popped.store(popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     }
 
-    inline void push_ready_packet(DataPacket* packet) {
-        readyQueue.push_back(packet);
+    // -- any thread
+
+    // Everything queued so far is dropped next time the consumer reads
+    inline void flush(void) {
+        flush_req.store(true, std::memory_order_release);
     }
 };
@@ -0,0 +1,156 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <string.h>
+#include "simd.h"
+#include "resample.h"
+#include "yuv420_yuyv.h"
+
+#define FRAC(pos) ((float) (uint32_t) (pos) * (1.0f / 4294967296.0f))
+
+void resampler_init(struct resampler *r, int channels) {
+    memset(r, 0, sizeof(*r));
+    r->channels = channels > RESAMPLE_MAX_CHANNELS ? RESAMPLE_MAX_CHANNELS : channels;
+}
+
+int resample_max_out(int frames, uint64_t step) {
+    return (int) (((uint64_t) frames << 32) / step) + 2;
+}
+
+static inline float lerp(float a, float b, float f) {
+    return a + (b - a) * f;
+}
+
+// Kernels for the middle of one plane, where every output has both of
+// its input samples in `in`. They stop once the next group would reach
+// `end` and return the number of samples written, *pos is advanced.
+//
+// The step is within a fraction of a percent of 1, so four consecutive
+// outputs nearly always read four consecutive input pairs: two unaligned
+// loads. Only where an input sample is skipped or repeated are they
+// gathered one by one.
+typedef int (*resample_fn)(const float *in, uint64_t *pos, uint64_t end,
+    uint64_t step, float *out);
+
+#if HAVE_SSE2
+static int resample_sse2(const float *in, uint64_t *pos, uint64_t end,
+    uint64_t step, float *out)
+{
+    uint64_t p = *pos;
+    int n = 0;
+    for (; p + 3 * step < end; p += 4 * step, n += 4) {
+        const uint64_t p1 = p + step, p2 = p1 + step, p3 = p2 + step;
+        const int i0 = (int) (p >> 32);
+        __m128 va, vb;
+        if ((int) (p3 >> 32) - i0 == 3) {
+            va = _mm_loadu_ps(in + i0 - 1);
+            vb = _mm_loadu_ps(in + i0);
+        } else {
+            const int i1 = (int) (p1 >> 32), i2 = (int) (p2 >> 32), i3 = (int) (p3 >> 32);
+            va = _mm_set_ps(in[i3 - 1], in[i2 - 1], in[i1 - 1], in[i0 - 1]);
+            vb = _mm_set_ps(in[i3], in[i2], in[i1], in[i0]);
+        }
+
+        const __m128 f = _mm_set_ps(FRAC(p3), FRAC(p2), FRAC(p1), FRAC(p));
+        _mm_storeu_ps(out + n, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), f)));
+    }
+
+    *pos = p;
+    return n;
+}
+#endif
+
+#if HAVE_NEON
+static int resample_neon(const float *in, uint64_t *pos, uint64_t end,
+    uint64_t step, float *out)
+{
+    uint64_t p = *pos;
+    int n = 0;
+    for (; p + 3 * step < end; p += 4 * step, n += 4) {
+        const uint64_t p1 = p + step, p2 = p1 + step, p3 = p2 + step;
+        const int i0 = (int) (p >> 32);
+        float32x4_t va, vb;
+        if ((int) (p3 >> 32) - i0 == 3) {
+            va = vld1q_f32(in + i0 - 1);
+            vb = vld1q_f32(in + i0);
+        } else {
+            const int i1 = (int) (p1 >> 32), i2 = (int) (p2 >> 32), i3 = (int) (p3 >> 32);
+            const float a[4] = { in[i0 - 1], in[i1 - 1], in[i2 - 1], in[i3 - 1] };
+            const float b[4] = { in[i0], in[i1], in[i2], in[i3] };
+            va = vld1q_f32(a);
+            vb = vld1q_f32(b);
+        }
+
+        const float f[4] = { FRAC(p), FRAC(p1), FRAC(p2), FRAC(p3) };
+        vst1q_f32(out + n, vaddq_f32(va, vmulq_f32(vsubq_f32(vb, va), vld1q_f32(f))));
+    }
+
+    *pos = p;
+    return n;
+}
+#endif
+
+static resample_fn select_resample_fn(void) {
+    #if HAVE_SSE2
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return resample_sse2;
+    #elif HAVE_NEON
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return resample_neon;
+    #endif
+    return NULL;
+}
+
+static int resample_plane(const float *in, float last, int frames, float *out,
+    uint64_t pos, uint64_t step, resample_fn fn)
+{
+    const uint64_t end = (uint64_t) frames << 32;
+    int n = 0;
+
+    // outputs that still reach back to the previous call
+    for (; pos < end && (pos >> 32) == 0; pos += step, n++)
+        out[n] = lerp(last, in[0], FRAC(pos));
+
+    if (fn && pos < end)
+        n += fn(in, &pos, end, step, out + n);
+
+    for (; pos < end; pos += step, n++) {
+        const int i = (int) (pos >> 32);
+        out[n] = lerp(in[i - 1], in[i], FRAC(pos));
+    }
+
+    return n;
+}
+
+int resample_f32(struct resampler *r, const float *const *in, int frames,
+    float *const *out, uint64_t step)
+{
+    const uint64_t end = (uint64_t) frames << 32;
+    resample_fn fn = select_resample_fn();
+    int n = 0;
+    if (frames <= 0 || r->channels <= 0)
+        return 0;
+
+    // every plane lands on the same positions
+    for (int c = 0; c < r->channels; c++) {
+        n = resample_plane(in[c], r->last[c], frames, out[c], r->pos, step, fn);
+        r->last[c] = in[c][frames - 1];
+    }
+
+    r->pos += (uint64_t) n * step - end;
+    return n;
+}
@@ -0,0 +1,35 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESAMPLE_MAX_CHANNELS 8
+#define RESAMPLE_ONE ((uint64_t) 1 << 32)
+
+// Linear interpolation between neighbouring frames, for nudging a stream
+// by a few hundred ppm to follow another clock. There is no filtering,
+// it is not meant for real sample rate changes.
+struct resampler {
+    int channels;
+    uint64_t pos;   // Q32, where the next output falls, 0 = on `last`
+    float last[RESAMPLE_MAX_CHANNELS];
+};
+
+void resampler_init(struct resampler *r, int channels);
+
+// Most frames resample_f32 can write for `frames` input frames
+int resample_max_out(int frames, uint64_t step);
+
+// Resample planar float audio, one plane per channel. step is input
+// frames per output frame in Q32, RESAMPLE_ONE keeps the rate.
+// Returns output frames. The stream runs one input frame behind,
+// the last one is kept for the next call.
+int resample_f32(struct resampler *r, const float *const *in, int frames,
+    float *const *out, uint64_t step);
+
+#ifdef __cplusplus
+} // "C"
+#endif
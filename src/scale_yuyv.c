@@ -0,0 +1,576 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simd.h"
+#include "scale_yuyv.h"
+#include "yuv420_yuyv.h"
+
+// Fixed ratio groups: `in` source pixels become `out` output pixels,
+// output n blends source a[n] with its neighbour b[n], either 1/2 + 1/2
+// or 3/4 + 1/4. 2:1 is a box filter, 3:2 samples the output centers and
+// 4:3 uses its area weights, all of which land on quarters. That keeps
+// them on byte averages (pavgb, vrhadd) with the same rounding as the
+// scalar code: m = avg(a, b), quarter = avg(a, m).
+struct scale_pattern {
+    int in, out;
+    int a[3], b[3];
+    int quarter[3];
+};
+
+static const struct scale_pattern patterns[] = {
+    { 0, 0, {0},       {0},       {0} },        // SCALE_BILINEAR, tables only
+    { 2, 1, {0},       {1},       {0} },        // SCALE_2_1
+    { 3, 2, {0, 2},    {1, 1},    {1, 1} },     // SCALE_3_2
+    { 4, 3, {0, 1, 3}, {1, 2, 2}, {1, 0, 1} },  // SCALE_4_3
+};
+
+const char *yuyv_scale_mode_name(int mode) {
+    switch (mode) {
+    case SCALE_2_1: return "2:1";
+    case SCALE_3_2: return "3:2";
+    case SCALE_4_3: return "4:3";
+    default:        return "bilinear";
+    }
+}
+
+// pshufb controls for 16 output bytes out of 32 source bytes:
+// a from the low/high source vector, b the same, then the quarter mask.
+// Lanes past out_step are zero and get overwritten by the next store.
+static void build_shuffle(struct scale_axis *axis) {
+    const struct scale_pattern *p = &patterns[axis->mode];
+    const int groups = 16 / p->out;
+    axis->out_step = groups * p->out;
+    axis->in_step  = groups * p->in;
+
+    memset(axis->shuffle, 0x80, sizeof(axis->shuffle));
+    for (int n = 0; n < axis->out_step; n++) {
+        const int g = n / p->out, k = n % p->out;
+        const int a = g * p->in + p->a[k];
+        const int b = g * p->in + p->b[k];
+        if (a < 16) axis->shuffle[0][n] = (uint8_t) a; else axis->shuffle[1][n] = (uint8_t)(a - 16);
+        if (b < 16) axis->shuffle[2][n] = (uint8_t) b; else axis->shuffle[3][n] = (uint8_t)(b - 16);
+        axis->shuffle[4][n] = p->quarter[k] ? 0xFF : 0;
+    }
+}
+
+static int build_axis(struct scale_axis *axis, int src, int dst, int fixed_ratio) {
+    axis->src = src;
+    axis->dst = dst;
+    axis->mode = SCALE_BILINEAR;
+    for (int mode = SCALE_2_1; fixed_ratio && mode <= SCALE_4_3; mode++) {
+        if ((int64_t) src * patterns[mode].out == (int64_t) dst * patterns[mode].in) {
+            axis->mode = mode;
+            build_shuffle(axis);
+            break;
+        }
+    }
+
+    axis->index = (int *) malloc(dst * sizeof(int));
+    axis->frac = (uint16_t *) malloc(dst * sizeof(uint16_t));
+    if (!axis->index || !axis->frac)
+        return 0;
+
+    // sample at the output pixel centers, 8 bits of fraction
+    for (int n = 0; n < dst; n++) {
+        int64_t pos = (((int64_t)(2*n + 1) * src) << 8) / (2 * dst) - 128;
+        if (pos < 0) pos = 0;
+
+        int i = (int)(pos >> 8);
+        int f = (int)(pos & 255);
+        if (i >= src - 1) {
+            i = src - 2;
+            f = 256;
+        }
+        axis->index[n] = i;
+        axis->frac[n] = (uint16_t) f;
+    }
+    return 1;
+}
+
+void yuyv_scaler_free(struct yuyv_scaler *s) {
+    struct scale_axis *axes[] = { &s->x_luma, &s->x_chroma, &s->y_luma, &s->y_chroma };
+    for (int i = 0; i < 4; i++) {
+        free(axes[i]->index);
+        free(axes[i]->frac);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+int yuyv_scaler_init(struct yuyv_scaler *s, int src_w, int src_h, int dst_w, int dst_h) {
+    yuyv_scaler_free(s);
+    if (src_w < 4 || src_h < 4 || dst_w < 2 || dst_h < 2 ||
+        dst_w > SCALE_MAX_WIDTH || src_w > SCALE_MAX_WIDTH * 2)
+        return 0;
+
+    s->src_w = src_w;
+    s->src_h = src_h;
+    s->dst_w = dst_w;
+    s->dst_h = dst_h;
+
+    // chroma keeps one row per output row, yuyv is 4:2:2
+    if (build_axis(&s->x_luma,   src_w,            dst_w,            1) &&
+        build_axis(&s->x_chroma, (src_w + 1) >> 1, (dst_w + 1) >> 1, 1) &&
+        build_axis(&s->y_luma,   src_h,            dst_h,            0) &&
+        build_axis(&s->y_chroma, (src_h + 1) >> 1, dst_h,            0))
+        return 1;
+
+    yuyv_scaler_free(s);
+    return 0;
+}
+
+// -- horizontal
+
+typedef void (*scale_row_fn)(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis);
+
+static void scale_row_bilinear(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    for (int x = 0; x < axis->dst; x++) {
+        const uint8_t *s = src + axis->index[x];
+        const int f = axis->frac[x];
+        dst[x] = (uint8_t)((s[0] * (256 - f) + s[1] * f + 128) >> 8);
+    }
+}
+
+#define AVG_U8(a, b) (((a) + (b) + 1) >> 1)
+
+// Outputs from x on, x has to start a group
+static void scale_row_fixed_tail(uint8_t *dst, const uint8_t *src,
+    const struct scale_axis *axis, int x)
+{
+    const struct scale_pattern *p = &patterns[axis->mode];
+    src += (x / p->out) * p->in;
+    while (x < axis->dst) {
+        for (int k = 0; k < p->out && x < axis->dst; k++, x++) {
+            const int a = src[p->a[k]];
+            const int m = AVG_U8(a, src[p->b[k]]);
+            dst[x] = (uint8_t)(p->quarter[k] ? AVG_U8(a, m) : m);
+        }
+        src += p->in;
+    }
+}
+
+static void scale_row_fixed_scalar(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    scale_row_fixed_tail(dst, src, axis, 0);
+}
+
+#if HAVE_SSE2
+static void scale_row_2_1_sse2(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    const int body = axis->dst & ~15;
+    const __m128i even = _mm_set1_epi16(0x00FF);
+
+    for (int x = 0; x < body; x += 16) {
+        __m128i s0 = _mm_loadu_si128((const __m128i*)(src + (x<<1)));
+        __m128i s1 = _mm_loadu_si128((const __m128i*)(src + (x<<1) + 16));
+        __m128i a0 = _mm_avg_epu16(_mm_and_si128(s0, even), _mm_srli_epi16(s0, 8));
+        __m128i a1 = _mm_avg_epu16(_mm_and_si128(s1, even), _mm_srli_epi16(s1, 8));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(a0, a1));
+    }
+
+    scale_row_fixed_tail(dst, src, axis, body);
+}
+#endif
+
+#if HAVE_AVX2
+// pshufb is SSSE3, which every AVX2 cpu has
+TARGET_AVX2
+static void scale_row_fixed_ssse3(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    const __m128i a_lo = _mm_loadu_si128((const __m128i*) axis->shuffle[0]);
+    const __m128i a_hi = _mm_loadu_si128((const __m128i*) axis->shuffle[1]);
+    const __m128i b_lo = _mm_loadu_si128((const __m128i*) axis->shuffle[2]);
+    const __m128i b_hi = _mm_loadu_si128((const __m128i*) axis->shuffle[3]);
+    const __m128i quarter = _mm_loadu_si128((const __m128i*) axis->shuffle[4]);
+
+    int x = 0, sx = 0;
+    for (; x + 16 <= axis->dst && sx + 32 <= axis->src; x += axis->out_step, sx += axis->in_step) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(src + sx));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(src + sx + 16));
+        __m128i a = _mm_or_si128(_mm_shuffle_epi8(lo, a_lo), _mm_shuffle_epi8(hi, a_hi));
+        __m128i b = _mm_or_si128(_mm_shuffle_epi8(lo, b_lo), _mm_shuffle_epi8(hi, b_hi));
+        __m128i m = _mm_avg_epu8(a, b);
+        __m128i q = _mm_avg_epu8(a, m);
+        _mm_storeu_si128((__m128i*)(dst + x),
+            _mm_or_si128(_mm_and_si128(quarter, q), _mm_andnot_si128(quarter, m)));
+    }
+
+    scale_row_fixed_tail(dst, src, axis, x);
+}
+#endif
+
+#if HAVE_NEON
+// the de-interleaving loads hand us one vector per group phase
+static void scale_row_2_1_neon(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    const int body = axis->dst & ~15;
+    for (int x = 0; x < body; x += 16) {
+        uint8x16x2_t s = vld2q_u8(src + (x<<1));
+        vst1q_u8(dst + x, vrhaddq_u8(s.val[0], s.val[1]));
+    }
+
+    scale_row_fixed_tail(dst, src, axis, body);
+}
+
+static void scale_row_3_2_neon(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    const int body = axis->dst & ~31;
+    for (int x = 0; x < body; x += 32) {
+        uint8x16x3_t s = vld3q_u8(src + (x>>1) * 3);
+        uint8x16x2_t d;
+        d.val[0] = vrhaddq_u8(s.val[0], vrhaddq_u8(s.val[0], s.val[1]));
+        d.val[1] = vrhaddq_u8(s.val[2], vrhaddq_u8(s.val[2], s.val[1]));
+        vst2q_u8(dst + x, d);
+    }
+
+    scale_row_fixed_tail(dst, src, axis, body);
+}
+
+static void scale_row_4_3_neon(uint8_t *dst, const uint8_t *src, const struct scale_axis *axis) {
+    const int body = (axis->dst / 48) * 48;
+    for (int x = 0; x < body; x += 48) {
+        uint8x16x4_t s = vld4q_u8(src + (x/3) * 4);
+        uint8x16x3_t d;
+        d.val[0] = vrhaddq_u8(s.val[0], vrhaddq_u8(s.val[0], s.val[1]));
+        d.val[1] = vrhaddq_u8(s.val[1], s.val[2]);
+        d.val[2] = vrhaddq_u8(s.val[3], vrhaddq_u8(s.val[3], s.val[2]));
+        vst3q_u8(dst + x, d);
+    }
+
+    scale_row_fixed_tail(dst, src, axis, body);
+}
+#endif
+
+static scale_row_fn select_scale_fn(int mode) {
+    const int level = yuyv_cpu_level();
+    if (mode == SCALE_BILINEAR)
+        return scale_row_bilinear;
+
+    #if HAVE_AVX2
+    if (level >= CPU_LEVEL_AVX2 && mode != SCALE_2_1)
+        return scale_row_fixed_ssse3;
+    #endif
+
+    #if HAVE_SSE2
+    if (level >= CPU_LEVEL_SIMD128 && mode == SCALE_2_1)
+        return scale_row_2_1_sse2;
+    #elif HAVE_NEON
+    if (level >= CPU_LEVEL_SIMD128) {
+        switch (mode) {
+        case SCALE_2_1: return scale_row_2_1_neon;
+        case SCALE_3_2: return scale_row_3_2_neon;
+        case SCALE_4_3: return scale_row_4_3_neon;
+        }
+    }
+    #else
+    (void) level;
+    #endif
+
+    return scale_row_fixed_scalar;
+}
+
+// -- vertical
+
+// r0 * (256 - f) + r1 * f, f is 1..255
+typedef void (*blend_rows_fn)(uint8_t *dst, const uint8_t *r0, const uint8_t *r1, int f, int width);
+
+static void blend_rows_scalar(uint8_t *dst, const uint8_t *r0, const uint8_t *r1, int f, int width) {
+    for (int x = 0; x < width; x++)
+        dst[x] = (uint8_t)((r0[x] * (256 - f) + r1[x] * f + 128) >> 8);
+}
+
+#if HAVE_SSE2
+static void blend_rows_sse2(uint8_t *dst, const uint8_t *r0, const uint8_t *r1, int f, int width) {
+    const int body = width & ~15;
+    if (f == 128) {
+        for (int x = 0; x < body; x += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(r0 + x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(r1 + x));
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_avg_epu8(a, b));
+        }
+    }
+    else {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w0 = _mm_set1_epi16((short)(256 - f));
+        const __m128i w1 = _mm_set1_epi16((short) f);
+        const __m128i round = _mm_set1_epi16(128);
+
+        // a * w0 + b * w1 + 128 stays below 65536, no sign games needed
+        #define BLEND16(a, b) _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16( \
+            _mm_mullo_epi16(a, w0), _mm_mullo_epi16(b, w1)), round), 8)
+
+        for (int x = 0; x < body; x += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(r0 + x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(r1 + x));
+            __m128i lo = BLEND16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = BLEND16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+        }
+        #undef BLEND16
+    }
+
+    blend_rows_scalar(dst + body, r0 + body, r1 + body, f, width - body);
+}
+#endif
+
+#if HAVE_NEON
+static void blend_rows_neon(uint8_t *dst, const uint8_t *r0, const uint8_t *r1, int f, int width) {
+    const int body = width & ~15;
+    const uint8x8_t w0 = vdup_n_u8((uint8_t)(256 - f));
+    const uint8x8_t w1 = vdup_n_u8((uint8_t) f);
+
+    for (int x = 0; x < body; x += 16) {
+        uint8x16_t a = vld1q_u8(r0 + x);
+        uint8x16_t b = vld1q_u8(r1 + x);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), w0), vget_low_u8(b), w1);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a), w0), vget_high_u8(b), w1);
+        vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+
+    blend_rows_scalar(dst + body, r0 + body, r1 + body, f, width - body);
+}
+#endif
+
+static blend_rows_fn select_blend_fn(void) {
+    #if HAVE_SSE2
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return blend_rows_sse2;
+    #elif HAVE_NEON
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return blend_rows_neon;
+    #endif
+    return blend_rows_scalar;
+}
+
+// -- nv12 chroma
+
+// Every other byte, u or v out of an interleaved nv12 row
+typedef void (*split_row_fn)(uint8_t *dst, const uint8_t *src, int width);
+
+static void split_row_scalar(uint8_t *dst, const uint8_t *src, int width) {
+    for (int x = 0; x < width; x++)
+        dst[x] = src[x<<1];
+}
+
+// The last vector is left to the scalar loop, for v the source is one
+// byte in and a full vector would read past the end of the row.
+#if HAVE_SSE2
+static void split_row_sse2(uint8_t *dst, const uint8_t *src, int width) {
+    const int body = (width - 1) & ~15;
+    const __m128i even = _mm_set1_epi16(0x00FF);
+    for (int x = 0; x < body; x += 16) {
+        __m128i s0 = _mm_loadu_si128((const __m128i*)(src + (x<<1)));
+        __m128i s1 = _mm_loadu_si128((const __m128i*)(src + (x<<1) + 16));
+        _mm_storeu_si128((__m128i*)(dst + x),
+            _mm_packus_epi16(_mm_and_si128(s0, even), _mm_and_si128(s1, even)));
+    }
+
+    split_row_scalar(dst + body, src + (body<<1), width - body);
+}
+#endif
+
+#if HAVE_NEON
+static void split_row_neon(uint8_t *dst, const uint8_t *src, int width) {
+    const int body = (width - 1) & ~15;
+    for (int x = 0; x < body; x += 16)
+        vst1q_u8(dst + x, vld2q_u8(src + (x<<1)).val[0]);
+
+    split_row_scalar(dst + body, src + (body<<1), width - body);
+}
+#endif
+
+static split_row_fn select_split_fn(void) {
+    #if HAVE_SSE2
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return split_row_sse2;
+    #elif HAVE_NEON
+    if (yuyv_cpu_level() >= CPU_LEVEL_SIMD128)
+        return split_row_neon;
+    #endif
+    return split_row_scalar;
+}
+
+// -- one plane
+
+// The last two horizontally scaled source rows are kept, consecutive
+// output rows mostly share one of them.
+struct scale_plane {
+    const struct scale_axis *x, *y;
+    const uint8_t *data;
+    uint32_t linesize;
+    scale_row_fn scale_row;
+    blend_rows_fn blend_rows;
+
+    // nv12 chroma is split out of the uv plane first
+    split_row_fn split_row;
+    uint8_t *split;
+
+    int row[2];
+    uint8_t *scaled[2];
+    uint8_t *blended;
+};
+
+static void scale_plane_init(struct scale_plane *p,
+    const struct scale_axis *x, const struct scale_axis *y,
+    const uint8_t *data, uint32_t linesize, uint8_t *buf, int buf_size)
+{
+    p->x = x;
+    p->y = y;
+    p->data = data;
+    p->linesize = linesize;
+    p->scale_row = select_scale_fn(x->mode);
+    p->blend_rows = select_blend_fn();
+    p->split_row = NULL;
+    p->split = NULL;
+    p->row[0] = p->row[1] = -1;
+    p->scaled[0] = buf;
+    p->scaled[1] = buf + buf_size;
+    p->blended = buf + (buf_size * 2);
+}
+
+// never evicts `keep`, the other half of the pair being blended
+static const uint8_t *scaled_row(struct scale_plane *p, int row, int keep) {
+    if (p->row[0] == row) return p->scaled[0];
+    if (p->row[1] == row) return p->scaled[1];
+
+    int i;
+    if (p->row[0] == keep)      i = 1;
+    else if (p->row[1] == keep) i = 0;
+    else                        i = p->row[0] < p->row[1] ? 0 : 1;
+
+    const uint8_t *src = p->data + (size_t) row * p->linesize;
+    if (p->split_row) {
+        p->split_row(p->split, src, p->x->src);
+        src = p->split;
+    }
+
+    p->row[i] = row;
+    p->scale_row(p->scaled[i], src, p->x);
+    return p->scaled[i];
+}
+
+static const uint8_t *output_row(struct scale_plane *p, int y) {
+    const int row = p->y->index[y];
+    const int f = p->y->frac[y];
+    if (f == 0)
+        return scaled_row(p, row, -1);
+    if (f == 256)
+        return scaled_row(p, row + 1, -1);
+
+    const uint8_t *r0 = scaled_row(p, row, -1);
+    const uint8_t *r1 = scaled_row(p, row + 1, row);
+    p->blend_rows(p->blended, r0, r1, f, p->x->dst);
+    return p->blended;
+}
+
+static void scale_rows(const struct yuyv_scaler *s, int nv12, int order,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end)
+{
+    const int linesize_dst = dest_width<<1;
+
+    if (row_end > s->dst_h) row_end = s->dst_h;
+
+    shift_x &= ~1;
+    dst += ((shift_y + row_start) * linesize_dst) + (shift_x<<1);
+
+    // per plane: two scaled source rows and the blended row
+    uint8_t buf_y[3 * SCALE_MAX_WIDTH];
+    uint8_t buf_u[3 * SCALE_MAX_WIDTH / 2];
+    uint8_t buf_v[3 * SCALE_MAX_WIDTH / 2];
+    uint8_t split[SCALE_MAX_WIDTH];
+
+    struct scale_plane py, pu, pv;
+    scale_plane_init(&py, &s->x_luma, &s->y_luma, data[0], linesize[0], buf_y, SCALE_MAX_WIDTH);
+    if (nv12) {
+        scale_plane_init(&pu, &s->x_chroma, &s->y_chroma, data[1],     linesize[1], buf_u, SCALE_MAX_WIDTH / 2);
+        scale_plane_init(&pv, &s->x_chroma, &s->y_chroma, data[1] + 1, linesize[1], buf_v, SCALE_MAX_WIDTH / 2);
+        pu.split_row = pv.split_row = select_split_fn();
+        pu.split = pv.split = split;
+    }
+    else {
+        scale_plane_init(&pu, &s->x_chroma, &s->y_chroma, data[1], linesize[1], buf_u, SCALE_MAX_WIDTH / 2);
+        scale_plane_init(&pv, &s->x_chroma, &s->y_chroma, data[2], linesize[2], buf_v, SCALE_MAX_WIDTH / 2);
+    }
+
+    yuyv_pack_row_fn pack_row = yuyv_select_pack_row(order);
+    const int stream = yuyv_use_stream((size_t) linesize_dst * dest_height);
+    for (int y = row_start; y < row_end; y++) {
+        pack_row(dst, output_row(&py, y), output_row(&pu, y), output_row(&pv, y), s->dst_w, stream);
+        dst += linesize_dst;
+    }
+
+    #if HAVE_SSE2
+    _mm_sfence();
+    #endif
+}
+
+void scale_yuv420_yuyv_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end)
+{
+    scale_rows(s, 0, ORDER_YUYV, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, row_start, row_end);
+}
+
+void scale_nv12_yuyv_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end)
+{
+    scale_rows(s, 1, ORDER_YUYV, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, row_start, row_end);
+}
+
+void scale_yuv420_uyvy_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end)
+{
+    scale_rows(s, 0, ORDER_UYVY, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, row_start, row_end);
+}
+
+void scale_nv12_uyvy_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end)
+{
+    scale_rows(s, 1, ORDER_UYVY, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, row_start, row_end);
+}
+
+void scale_yuv420_yuyv(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height)
+{
+    scale_yuv420_yuyv_rows(s, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, 0, s->dst_h);
+}
+
+void scale_nv12_yuyv(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height)
+{
+    scale_rows(s, 1, ORDER_YUYV, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, 0, s->dst_h);
+}
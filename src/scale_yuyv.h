@@ -0,0 +1,89 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Widest scaled image, the working rows live on the stack
+#define SCALE_MAX_WIDTH 4096
+
+enum scale_mode {
+    SCALE_BILINEAR = 0,
+    SCALE_2_1,  // every 2 source pixels -> 1
+    SCALE_3_2,  // every 3 source pixels -> 2
+    SCALE_4_3,  // every 4 source pixels -> 3
+};
+
+// One direction of one plane. Output n samples source pixels
+// index[n] and index[n]+1, frac[n] (0..256) is the weight of the second.
+struct scale_axis {
+    int mode;
+    int src, dst;
+    int *index;
+    uint16_t *frac;
+
+    // fixed ratio kernels: pshufb controls and blend mask, see build_shuffle
+    int in_step, out_step;
+    uint8_t shuffle[5][16];
+};
+
+// I420 or NV12 -> scaled YUYV in one pass over the frame. Rows are scaled
+// horizontally (fixed ratio fast path or bilinear), blended vertically
+// and packed straight into the destination.
+struct yuyv_scaler {
+    int src_w, src_h;
+    int dst_w, dst_h;
+    struct scale_axis x_luma, x_chroma;
+    struct scale_axis y_luma, y_chroma;
+};
+
+// Returns 0 if the sizes are not supported or on allocation failure.
+// Re-initializing an initialized scaler frees the old tables.
+int yuyv_scaler_init(struct yuyv_scaler *s, int src_w, int src_h, int dst_w, int dst_h);
+void yuyv_scaler_free(struct yuyv_scaler *s);
+
+const char *yuyv_scale_mode_name(int mode);
+
+// Scale and convert output rows [row_start, row_end) of the dst_w x dst_h
+// image, placed at shift_x, shift_y in the dest_width x dest_height frame.
+void scale_yuv420_yuyv_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end);
+
+void scale_yuv420_yuyv(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height);
+
+// Same for NV12, data[1] is the interleaved uv plane
+void scale_nv12_yuyv_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end);
+
+void scale_nv12_yuyv(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height);
+
+// UYVY output, same arguments
+void scale_yuv420_uyvy_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end);
+
+void scale_nv12_uyvy_rows(const struct yuyv_scaler *s,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    int row_start, int row_end);
+
+#ifdef __cplusplus
+} // "C"
+#endif
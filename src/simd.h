@@ -0,0 +1,41 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+
+// Instruction sets the kernels are built with, shared by the
+// conversion and scaling code. Wider x86 levels are still gated on
+// yuyv_cpu_level() at runtime.
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #define HAVE_NEON 1
+    #include <arm_neon.h>
+
+#elif defined(_MSC_VER)
+    /* MSVC */
+    #if defined(_M_AMD64) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && (_M_IX86_FP == 2))
+        #define HAVE_SSE2 1
+        #define HAVE_AVX2 1
+        #include <intrin.h>
+        #include <immintrin.h>
+    #endif
+
+#elif defined(__x86_64__)
+    /* GCC / Clang */
+    #if defined(__SSE2__)
+        #define HAVE_SSE2 1
+        #define HAVE_AVX2 1
+        #include <cpuid.h>
+        #include <x86intrin.h>
+    #endif
+
+#endif
+
+#if HAVE_AVX2 && (!defined(_MSC_VER) || defined(__clang__))
+    // AVX2/AVX-512 code is only enabled per function, the rest of the
+    // binary stays baseline and the cpu level is checked at runtime
+    #define TARGET_AVX2   __attribute__((target("avx2")))
+    #define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#else
+    #define TARGET_AVX2
+    #define TARGET_AVX512
+#endif
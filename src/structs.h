@@ -13,20 +13,38 @@
 #define ALIGNMENT 32
 #define ALIGN_SIZE(size, align) size = (((size) + (align - 1)) & (~(align - 1)))
 
-#define VIDEO_MAP_SIZE  (sizeof(VideoHeader) + RGB_BUFFER_SIZE(MAX_WIDTH,MAX_HEIGHT))
+// Legacy consumers use slot 0 only, which fits in the old RGB sized map
+#define VIDEO_FRAME_SLOTS 3
+#define VIDEO_SLOT_SIZE (MAX_WIDTH*MAX_HEIGHT*2)
+#define VIDEO_MAP_SIZE  (sizeof(VideoHeader) + (VIDEO_SLOT_SIZE * VIDEO_FRAME_SLOTS))
 
-#define SAMPLE_BITS    16
-#define OBS_AUDIO_FMT  AUDIO_FORMAT_16BIT
-#define MAX_CHANNELZ   2
+// OBS hands us planar float, the plugin converts to the consumer's format
+#define OBS_AUDIO_FMT  AUDIO_FORMAT_FLOAT_PLANAR
+#define MAX_CHANNELZ   8
 #define DEF_FRAMES     1024
 #define CHUNKS_COUNT   2
-#define AUDIO_DATA_SIZE  ((SAMPLE_BITS/8) * DEF_FRAMES * MAX_CHANNELZ)
-#define AUDIO_MAP_SIZE   (sizeof(AudioHeader) + (AUDIO_DATA_SIZE * CHUNKS_COUNT))
 
-#define AUDIO_MAP_NAME     L"DroidCamOBS_AudioOut0"
-#define VIDEO_MAP_NAME     L"DroidCamOBS_VideoOut1"
-#define VIDEO_WR_LOCK_NAME L"DroidCamOBS_VideoWr1"
-#define VIDEO_RD_LOCK_NAME L"DroidCamOBS_VideoRd1"
+// The data area keeps its original size, 16-bit stereo chunks of
+// DEF_FRAMES. A chunk may use all of it (AUDIO_CHUNK_BYTES), wider
+// formats get fewer frames per chunk.
+#define AUDIO_DATA_SIZE   (2 * DEF_FRAMES * 2)
+#define AUDIO_CHUNK_BYTES (AUDIO_DATA_SIZE * CHUNKS_COUNT)
+#define AUDIO_MAP_SIZE    (sizeof(AudioHeader) + AUDIO_CHUNK_BYTES)
+
+#define AUDIO_MAP_NAME     "DroidCamOBS_AudioOut0"
+#define AUDIO_RD_EVENT_NAME "DroidCamOBS_AudioRd0"
+#define VIDEO_MAP_NAME     "DroidCamOBS_VideoOut1"
+#define VIDEO_WR_LOCK_NAME "DroidCamOBS_VideoWr1"
+#define VIDEO_RD_LOCK_NAME "DroidCamOBS_VideoRd1"
+
+// Raised by consumers after changing (or clearing) a header, so the
+// plugin reconfigures right away instead of at its next 1s check
+#define CONTROL_EVENT_NAME "DroidCamOBS_Control1"
+
+// Each output instance has its own set of the names above. Instance 0
+// uses them as they are, which is what the drivers open, instance n > 0
+// appends "_n": "DroidCamOBS_VideoOut1_2" and so on.
+#define MAX_INSTANCES 8
 
 #define REG_WEBCAM_SIZE_KEY  L"SOFTWARE\\DroidCam"
 #define REG_WEBCAM_SIZE_VAL  L"Size"
@@ -35,6 +53,20 @@
 extern "C" {
 #endif // __cplusplus
 
+/* Frame formats for DroidCamVideoInfo.format, as FOURCC codes.
+ * 0 means YUY2, what the plugin always wrote before.
+ * Frames start at the beginning of a slot, with no row padding:
+ *   YUY2, UYVY  width * 2 bytes per row
+ *   NV12        Y plane, then the interleaved UV plane at height / 2 rows
+ *   I420        Y plane, then U and V at width / 2 x height / 2 */
+#define MAKE_FOURCC(a, b, c, d) \
+    ((unsigned)(a) | ((unsigned)(b) << 8) | ((unsigned)(c) << 16) | ((unsigned)(d) << 24))
+
+#define FOURCC_YUY2 MAKE_FOURCC('Y', 'U', 'Y', '2')
+#define FOURCC_UYVY MAKE_FOURCC('U', 'Y', 'V', 'Y')
+#define FOURCC_NV12 MAKE_FOURCC('N', 'V', '1', '2')
+#define FOURCC_I420 MAKE_FOURCC('I', '4', '2', '0')
+
 /* Video Header */
 typedef struct {
     int version;
@@ -45,9 +77,38 @@ typedef struct {
     int format;
 } DroidCamVideoInfo;
 
+/* Frame slots (triple buffering)
+ * A consumer that sets frame_slots = VIDEO_FRAME_SLOTS opts in: the plugin
+ * never waits on it and never writes the slot named in `reading`.
+ * Consumers that leave it at 0 get the single buffer protocol in slot 0,
+ * guarded by the VideoWr/VideoRd events.
+ *
+ * Writer, per frame:
+ *   pick s != latest, s != reading
+ *   slot_seq[s]++ (odd: being written), write slot s, slot_seq[s]++ (even)
+ *   latest = s, seq++
+ * Reader:
+ *   s = latest, reading = s (full barrier)
+ *   q = slot_seq[s], retry if odd; read slot s; retry if slot_seq[s] != q
+ *
+ * slot_pts is the OBS timestamp of the frame in a slot, written with the
+ * slot (slot 0 in the single buffer protocol). It is on the monotonic
+ * clock (CLOCK_MONOTONIC, QueryPerformanceCounter), in ns.
+ *
+ * All fields are updated with atomic ops. */
+typedef struct {
+    long frame_slots;  // consumer
+    long reading;      // consumer, -1 = none
+    long latest;       // plugin, -1 = no frame yet
+    long seq;          // plugin, number of frames published
+    long slot_seq[VIDEO_FRAME_SLOTS]; // plugin
+    long long slot_pts[VIDEO_FRAME_SLOTS]; // plugin
+} VideoFrameRing;
+
 typedef union {
     struct {
         DroidCamVideoInfo info;
+        VideoFrameRing ring;
     };
     char pad[1024];
 } VideoHeader;
@@ -61,10 +122,36 @@ typedef struct {
     int channels;
 } DroidCamAudioInfo;
 
+/* Audio chunk handoff
+ * The plugin fills the data area and sets data_valid, the consumer
+ * clears data_valid once it has taken the chunk. Consumers that also
+ * raise AUDIO_RD_EVENT_NAME right after clearing it should set
+ * data_event = 1, the plugin then stops polling data_valid.
+ *
+ * Chunks are chunk_frames long, DEF_FRAMES unless the consumer asks for
+ * less (AUDIO_MIN_FRAMES at least) or the format does not fit in
+ * AUDIO_CHUNK_BYTES. Smaller chunks mean less latency.
+ * `frames` is the length of the chunk in the data area, `pts` the OBS
+ * timestamp of its first frame (same clock as VideoFrameRing.slot_pts).
+ *
+ * Samples are interleaved in sample_format, info.channels per frame,
+ * in the usual WAVE order (L R C LFE RL RR SL SR for 7.1).
+ * Unknown formats get SAMPLE_FMT_S16. */
+#define AUDIO_MIN_FRAMES 64
+
+#define SAMPLE_FMT_S16 0  // signed 16-bit
+#define SAMPLE_FMT_S24 1  // signed 24-bit, packed in 3 bytes
+#define SAMPLE_FMT_F32 2  // float, -1.0 .. 1.0
+
 typedef union {
     struct {
         DroidCamAudioInfo info;
         int data_valid;
+        int data_event;
+        int chunk_frames; // consumer, 0 = DEF_FRAMES
+        int frames;       // plugin, set before data_valid
+        int sample_format; // consumer, SAMPLE_FMT_*
+        long long pts;    // plugin, set before data_valid
     };
     char pad[1024];
 } AudioHeader;
@@ -0,0 +1,298 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "plugin.h"
+#include "transport.h"
+
+// Like the paging file mappings on windows, an object lives as long as
+// either side has it open: every user holds a shared flock on it, and
+// whoever closes last (the exclusive lock goes through) unlinks the name.
+// A new output instance re-attaches while the driver side still has it.
+// Where flock does not work on shm objects (macOS) nothing is unlinked,
+// the names are left for the next run or for `rm /dev/shm/<name>`.
+//
+// Owner only: the camera feed is private, and the driver side runs as
+// the same user as OBS.
+#define SHM_MODE 0600
+
+static int OpenShm(const char *name, size_t size, bool *created, char *path, size_t path_size) {
+    snprintf(path, path_size, "/%s", name);
+
+    *created = true;
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, SHM_MODE);
+    if (fd < 0 && errno == EEXIST) {
+        *created = false;
+        fd = shm_open(path, O_RDWR, SHM_MODE);
+    }
+    if (fd < 0) {
+        elog("shm_open(%s) failed: %s", path, strerror(errno));
+        return -1;
+    }
+
+    // only fails while the last user is in the middle of unlinking
+    flock(fd, LOCK_SH | LOCK_NB);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size < size) {
+        if (ftruncate(fd, size) != 0) {
+            elog("ftruncate(%s, %lu) failed: %s", path, (unsigned long) size, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+#ifdef __linux__
+// shm_open objects live on the /dev/shm tmpfs, which only hands out huge
+// pages for MADV_HUGEPAGE ranges when mounted with huge=advise (or
+// within_size, always)
+static void CheckShmemHugePages(void) {
+    static bool checked;
+    if (checked)
+        return;
+
+    checked = true;
+    bool huge = false;
+    char line[512];
+    FILE *f = fopen("/proc/mounts", "r");
+    if (f) {
+        while (fgets(line, sizeof(line), f)) {
+            if (strstr(line, " /dev/shm ") && strstr(line, "huge=")
+                && !strstr(line, "huge=never") && !strstr(line, "huge=deny"))
+                huge = true;
+        }
+        fclose(f);
+    }
+
+    if (!huge)
+        elog("huge pages are off for /dev/shm, it needs to be mounted with huge=advise");
+}
+#endif
+
+// Huge page advice has to come before the first touch
+static void PrepareShm(void *mem, size_t size, int flags, const char *name) {
+    #ifdef __linux__
+    if (flags & SHM_LARGE_PAGES) {
+        CheckShmemHugePages();
+        if (madvise(mem, size, MADV_HUGEPAGE) != 0)
+            elog("madvise(%s, MADV_HUGEPAGE) failed: %s", name, strerror(errno));
+    }
+    #endif
+
+    if (flags & SHM_LOCKED) {
+        #ifdef MADV_POPULATE_WRITE
+        // write faults up front, mlock alone would only read fault them
+        madvise(mem, size, MADV_POPULATE_WRITE);
+        #endif
+        if (mlock(mem, size) != 0)
+            elog("mlock(%s) failed: %s, pages can still be swapped out", name, strerror(errno));
+    }
+}
+
+bool CreateSharedMem(SharedMem *shm, const char *name, size_t size, int flags)
+{
+    bool created;
+    shm->mem = NULL;
+    shm->size = 0;
+    shm->fd = OpenShm(name, size, &created, shm->path, sizeof(shm->path));
+    if (shm->fd < 0)
+        return false;
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm->fd, 0);
+    if (mem == MAP_FAILED) {
+        elog("mmap Failed !! %s", strerror(errno));
+        close(shm->fd);
+        shm->fd = -1;
+        return false;
+    }
+
+    if (flags)
+        PrepareShm(mem, size, flags, name);
+
+    shm->mem = (uint8_t*) mem;
+    shm->size = size;
+    return true;
+}
+
+void CloseSharedMem(SharedMem *shm) {
+    if (shm->mem) {
+        munmap(shm->mem, shm->size);
+        if (flock(shm->fd, LOCK_EX | LOCK_NB) == 0)
+            shm_unlink(shm->path);
+        close(shm->fd);
+    }
+    shm->mem = NULL;
+    shm->size = 0;
+    shm->fd = -1;
+}
+
+// Events: one 32-bit word, 0 = reset, 1 = signaled.
+
+static inline volatile int *event_word(SharedEvent *ev) {
+    return (volatile int *) ev->shm.mem;
+}
+
+#ifdef __linux__
+static inline void futex_wake_all(volatile int *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void futex_wait(volatile int *addr, int val, const struct timespec *rel) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, rel, NULL, 0);
+}
+#endif
+
+bool CreateSharedEvent(SharedEvent *ev, const char *name, bool manual_reset, bool initial_state) {
+    bool created;
+    ev->auto_reset = !manual_reset;
+    ev->shm.mem = NULL;
+    ev->shm.size = 0;
+    ev->shm.fd = OpenShm(name, sizeof(int), &created, ev->shm.path, sizeof(ev->shm.path));
+    if (ev->shm.fd < 0)
+        return false;
+
+    void *mem = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED, ev->shm.fd, 0);
+    if (mem == MAP_FAILED) {
+        elog("mmap Failed !! %s", strerror(errno));
+        close(ev->shm.fd);
+        ev->shm.fd = -1;
+        return false;
+    }
+
+    ev->shm.mem = (uint8_t*) mem;
+    ev->shm.size = sizeof(int);
+    if (created && initial_state)
+        __atomic_store_n(event_word(ev), 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+void CloseSharedEvent(SharedEvent *ev) {
+    CloseSharedMem(&ev->shm);
+}
+
+void SetSharedEvent(SharedEvent *ev) {
+    volatile int *word = event_word(ev);
+    if (__atomic_exchange_n(word, 1, __ATOMIC_ACQ_REL) == 0) {
+        #ifdef __linux__
+        futex_wake_all(word);
+        #endif
+    }
+}
+
+void ResetSharedEvent(SharedEvent *ev) {
+    __atomic_store_n(event_word(ev), 0, __ATOMIC_RELEASE);
+}
+
+static inline bool try_event(SharedEvent *ev) {
+    volatile int *word = event_word(ev);
+    if (ev->auto_reset) {
+        int expected = 1;
+        return __atomic_compare_exchange_n(word, &expected, 0, false,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+
+    return __atomic_load_n(word, __ATOMIC_ACQUIRE) == 1;
+}
+
+bool WaitSharedEvent(SharedEvent *ev, int timeout_ms) {
+    struct timespec now, deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec  += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec ++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (!try_event(ev)) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        struct timespec rel;
+        rel.tv_sec  = deadline.tv_sec  - now.tv_sec;
+        rel.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (rel.tv_nsec < 0) {
+            rel.tv_sec --;
+            rel.tv_nsec += 1000000000L;
+        }
+        if (rel.tv_sec < 0)
+            return false;
+
+        #ifdef __linux__
+        futex_wait(event_word(ev), 0, &rel);
+        #else
+        // no cross-process futex here, poll
+        usleep(500);
+        #endif
+    }
+
+    return true;
+}
+
+bool SetThreadAffinity(int cpu) {
+    #ifdef __linux__
+    cpu_set_t set;
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    #else
+    // no hard affinity on macOS
+    (void) cpu;
+    return false;
+    #endif
+}
+
+bool SetThreadRealtime(int priority, bool round_robin, const char *task) {
+    (void) task;
+    const int policy = round_robin ? SCHED_RR : SCHED_FIFO;
+    const int lo = sched_get_priority_min(policy);
+    const int hi = sched_get_priority_max(policy);
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority < lo ? lo : priority > hi ? hi : priority;
+    return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+
+int GetCurrentCpu(void) {
+    #ifdef __linux__
+    return sched_getcpu();
+    #else
+    return -1;
+    #endif
+}
@@ -15,36 +15,190 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "plugin.h"
-// #pragma comment(lib, "advapi32")
+#include "transport.h"
+#include <avrt.h>
+#pragma comment(lib, "advapi32")
+#pragma comment(lib, "avrt")
 
-bool CreateSharedMem(LPHANDLE phFileMapping, LPVOID* ppSharedMem,
-    const LPCWSTR name, DWORD size)
+// Large page sections need SeLockMemoryPrivilege, which the account
+// only has with the "Lock pages in memory" user right
+static bool EnableLockMemoryPrivilege(void) {
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    TOKEN_PRIVILEGES tp;
+    tp.PrivilegeCount = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool ok = LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &tp.Privileges[0].Luid)
+        && AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL)
+        && GetLastError() == ERROR_SUCCESS; // not ERROR_NOT_ALL_ASSIGNED
+
+    CloseHandle(token);
+    return ok;
+}
+
+// *large is false when the mapping existed already, made by the driver
+static HANDLE CreateLargePageMapping(const char *name, size_t size, bool *large) {
+    const SIZE_T page = GetLargePageMinimum();
+    if (!page || !EnableLockMemoryPrivilege()) {
+        elog("large pages need the \"Lock pages in memory\" right, using normal pages");
+        return NULL;
+    }
+
+    // the section and its views are whole large pages
+    const uint64_t map_size = ((uint64_t) size + page - 1) & ~((uint64_t) page - 1);
+    HANDLE hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+        PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+        (DWORD) (map_size >> 32), (DWORD) map_size, name);
+
+    const DWORD error = GetLastError();
+    *large = hMapping != NULL && error != ERROR_ALREADY_EXISTS;
+    if (hMapping == NULL)
+        elog("large page mapping failed (%lu), using normal pages", error);
+    else if (!*large)
+        ilog("%s already exists, large pages only if the driver made it so", name);
+
+    return hMapping;
+}
+
+// Large pages are always resident, others get faulted in and locked
+static void LockMapping(void *mem, size_t size, const char *name) {
+    if (VirtualLock(mem, size))
+        return;
+
+    SIZE_T min_ws, max_ws;
+    HANDLE process = GetCurrentProcess();
+    if (GetProcessWorkingSetSize(process, &min_ws, &max_ws)
+        && SetProcessWorkingSetSize(process, min_ws + size, max_ws + size)
+        && VirtualLock(mem, size))
+        return;
+
+    elog("VirtualLock(%s) failed (%lu), pages can still be paged out", name, GetLastError());
+}
+
+bool CreateSharedMem(SharedMem *shm, const char *name, size_t size, int flags)
 {
-    *phFileMapping = CreateFileMappingW(
-        INVALID_HANDLE_VALUE, // use paging file
-        NULL,                 // default security attributes
-        PAGE_READWRITE,
-        0,    // size: high 32-bits
-        size, // size: low 32-bits
-        name);
-
-    if(*phFileMapping == NULL) {
-        *ppSharedMem = NULL;
+    HANDLE hMapping = NULL;
+    bool large = false;
+    if (flags & SHM_LARGE_PAGES)
+        hMapping = CreateLargePageMapping(name, size, &large);
+
+    if (hMapping == NULL) {
+        hMapping = CreateFileMappingA(
+            INVALID_HANDLE_VALUE, // use paging file
+            NULL,                 // default security attributes
+            PAGE_READWRITE,
+            0,    // size: high 32-bits
+            (DWORD) size, // size: low 32-bits
+            name);
+    }
+
+    shm->mem = NULL;
+    shm->size = 0;
+    shm->hMapping = NULL;
+
+    if(hMapping == NULL) {
         elog("CreateFileMapping Failed !! ");
         return false;
     }
 
-    *ppSharedMem = MapViewOfFile(*phFileMapping, FILE_MAP_WRITE, 0,0,0);
-    if(*ppSharedMem == NULL) {
+    LPVOID mem = MapViewOfFile(hMapping, FILE_MAP_WRITE, 0,0,0);
+    if(mem == NULL) {
         elog("MapViewOfFile Failed !! ");
-        CloseHandle(*phFileMapping);
-        *phFileMapping = NULL;
+        CloseHandle(hMapping);
         return false;
     }
 
+    // A mapping the driver made first keeps its own size, which can be
+    // less than asked for. Only lock and report what the view covers.
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(mem, &info, sizeof(info)) && info.RegionSize < size) {
+        elog("%s is %llu bytes, %llu asked for", name,
+            (unsigned long long) info.RegionSize, (unsigned long long) size);
+        size = info.RegionSize;
+    }
+
+    if ((flags & SHM_LOCKED) && !large)
+        LockMapping(mem, size, name);
+
+    shm->mem = (uint8_t*) mem;
+    shm->size = size;
+    shm->hMapping = hMapping;
+    return true;
+}
+
+void CloseSharedMem(SharedMem *shm) {
+    if (shm->mem) {
+        UnmapViewOfFile(shm->mem);
+        CloseHandle(shm->hMapping);
+    }
+    shm->mem = NULL;
+    shm->size = 0;
+    shm->hMapping = NULL;
+}
+
+bool CreateSharedEvent(SharedEvent *ev, const char *name, bool manual_reset, bool initial_state) {
+    ev->hEvent = CreateEventA(NULL, manual_reset, initial_state, name);
+    if (ev->hEvent == NULL) {
+        elog("CreateEvent Failed !! ");
+        return false;
+    }
     return true;
 }
 
+void CloseSharedEvent(SharedEvent *ev) {
+    if (ev->hEvent) CloseHandle(ev->hEvent);
+    ev->hEvent = NULL;
+}
+
+void SetSharedEvent(SharedEvent *ev) {
+    SetEvent(ev->hEvent);
+}
+
+void ResetSharedEvent(SharedEvent *ev) {
+    ResetEvent(ev->hEvent);
+}
+
+bool WaitSharedEvent(SharedEvent *ev, int timeout_ms) {
+    return WaitForSingleObject(ev->hEvent, timeout_ms) == WAIT_OBJECT_0;
+}
+
+bool SetThreadAffinity(int cpu) {
+    if (cpu < 0 || cpu >= (int)(sizeof(DWORD_PTR) * 8))
+        return false;
+
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+}
+
+// MMCSS registration of the calling thread
+static thread_local HANDLE mmcss_task;
+
+bool SetThreadRealtime(int priority, bool round_robin, const char *task) {
+    (void) round_robin;
+    DWORD index = 0;
+    mmcss_task = AvSetMmThreadCharacteristicsA(task, &index);
+    if (mmcss_task) {
+        AvSetMmThreadPriority(mmcss_task, priority >= 50 ? AVRT_PRIORITY_CRITICAL : AVRT_PRIORITY_HIGH);
+        return true;
+    }
+
+    // MMCSS service not running, plain thread priority instead
+    return SetThreadPriority(GetCurrentThread(),
+        priority >= 50 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST) != 0;
+}
+
+void ResetThreadRealtime(void) {
+    if (mmcss_task) {
+        AvRevertMmThreadCharacteristics(mmcss_task);
+        mmcss_task = NULL;
+    }
+}
+
+int GetCurrentCpu(void) {
+    return (int) GetCurrentProcessorNumber();
+}
+
 #if 0
 int GetRegValInt(const LPCWSTR path, const LPCWSTR entry) {
     HKEY key;
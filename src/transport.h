@@ -0,0 +1,56 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared memory + named events used to talk to the webcam drivers.
+// Windows: file mappings and events from the paging file (sys-win.cc).
+// POSIX: shm_open objects, events are a futex word in their own tiny
+// shm object (sys-posix.cc). Names are plain ascii, without a leading '/'.
+
+struct SharedMem {
+    uint8_t *mem;
+    size_t size;
+    #ifdef _WIN32
+    void *hMapping;
+    #else
+    int fd;
+    char path[64];  // shm_open name, to unlink it
+    #endif
+};
+
+struct SharedEvent {
+    #ifdef _WIN32
+    void *hEvent;
+    #else
+    SharedMem shm;
+    bool auto_reset;
+    #endif
+};
+
+// CreateSharedMem flags, both best effort: what the system refuses is
+// logged and the mapping works as usual
+#define SHM_LARGE_PAGES 1  // huge pages (linux: shmem THP) / large page section (windows)
+#define SHM_LOCKED      2  // fault every page in now and lock it in memory
+
+bool CreateSharedMem(SharedMem *shm, const char *name, size_t size, int flags = 0);
+// POSIX: the last side to close an object also removes its name
+void CloseSharedMem(SharedMem *shm);
+
+// Same semantics as win32 CreateEvent: initial_state only applies
+// if the event did not exist yet.
+bool CreateSharedEvent(SharedEvent *ev, const char *name, bool manual_reset, bool initial_state);
+void CloseSharedEvent(SharedEvent *ev);
+void SetSharedEvent(SharedEvent *ev);
+void ResetSharedEvent(SharedEvent *ev);
+
+// Returns true if the event was signaled within timeout_ms.
+bool WaitSharedEvent(SharedEvent *ev, int timeout_ms);
+
+static inline bool SharedEventValid(SharedEvent *ev) {
+    #ifdef _WIN32
+    return ev->hEvent != NULL;
+    #else
+    return ev->shm.mem != NULL;
+    #endif
+}
@@ -0,0 +1,184 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <util/platform.h>
+#include "plugin.h"
+#include "workers.h"
+
+void apply_thread_policy(const char *name, const thread_policy *policy, const char *task) {
+    if (policy->cpu >= 0 && !SetThreadAffinity(policy->cpu))
+        elog("%s: could not pin to cpu %d", name, policy->cpu);
+
+    if (policy->priority > 0 && !SetThreadRealtime(policy->priority, policy->round_robin, task))
+        elog("%s: real time priority %d refused", name, policy->priority);
+
+    dlog("%s: cpu %d, priority %d%s", name, policy->cpu, policy->priority,
+        policy->round_robin ? " rr" : "");
+}
+
+const char *format_cpus(char *buf, size_t size, uint64_t seen) {
+    size_t len = 0;
+    buf[0] = 0;
+
+    for (int cpu = 0; cpu < 64 && len < size; cpu++) {
+        if (!(seen & ((uint64_t) 1 << cpu)))
+            continue;
+
+        int last = cpu;
+        while (last < 63 && (seen & ((uint64_t) 1 << (last + 1))))
+            last++;
+
+        int n = last == cpu
+            ? snprintf(buf + len, size - len, "%s%d", len ? "," : "", cpu)
+            : snprintf(buf + len, size - len, "%s%d-%d", len ? "," : "", cpu, last);
+        if (n < 0)
+            break;
+
+        len += n;
+        cpu = last;
+    }
+
+    if (len == 0)
+        snprintf(buf, size, "?");
+
+    return buf;
+}
+
+struct worker_ctx {
+    WorkerPool *pool;
+    int index;
+};
+
+static void *worker_thread(void *data) {
+    worker_ctx *ctx = reinterpret_cast<worker_ctx *>(data);
+    WorkerPool *pool = ctx->pool;
+    const int index = ctx->index;
+    delete ctx;
+
+    // pinned only on request: a hard pin to a core that an encoder or
+    // other pinned software keeps busy would stall on_video behind it
+    const int cores = os_get_logical_cores();
+    thread_policy policy = pool->policy;
+    if (policy.cpu >= 0)
+        policy.cpu = (policy.cpu + index) % cores;
+
+    char name[32];
+    snprintf(name, sizeof(name), "worker %d", index);
+    apply_thread_policy(name, &policy, "Capture");
+
+    os_set_thread_name("droidcam-worker");
+    dlog("worker %d start", index);
+
+    while (1) {
+        os_sem_wait(pool->start[index]);
+        if (pool->quit)
+            break;
+
+        note_cpu(&pool->cpus[index]);
+
+        // band 0 belongs to the caller
+        const int band = index + 1;
+        if (band < pool->bands)
+            pool->fn(pool->arg, band, pool->bands);
+
+        os_sem_post(pool->done);
+    }
+
+    ResetThreadRealtime();
+    dlog("worker %d end", index);
+    return 0;
+}
+
+bool worker_pool_init(WorkerPool *pool, int count, const thread_policy *policy) {
+    memset(pool, 0, sizeof(WorkerPool));
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pool->policy = *policy;
+
+    const int cores = os_get_logical_cores();
+    if (count <= 0) {
+        // leave half the machine to OBS and the encoders
+        count = cores / 2 - 1;
+    }
+    if (count > MAX_WORKERS) count = MAX_WORKERS;
+    if (count > cores - 1) count = cores - 1;
+    if (count <= 0)
+        return false;
+
+    if (os_sem_init(&pool->done, 0) != 0)
+        return false;
+
+    for (int i = 0; i < count; i++) {
+        if (os_sem_init(&pool->start[i], 0) != 0)
+            break;
+
+        worker_ctx *ctx = new worker_ctx { pool, i };
+        if (pthread_create(&pool->threads[i], NULL, worker_thread, ctx) != 0) {
+            delete ctx;
+            os_sem_destroy(pool->start[i]);
+            pool->start[i] = NULL;
+            break;
+        }
+        pool->count++;
+    }
+
+    ilog("conversion workers: %d", pool->count);
+    return pool->count > 0;
+}
+
+void worker_pool_destroy(WorkerPool *pool) {
+    pool->quit = true;
+    for (int i = 0; i < pool->count; i++)
+        os_sem_post(pool->start[i]);
+
+    for (int i = 0; i < pool->count; i++) {
+        pthread_join(pool->threads[i], NULL);
+        os_sem_destroy(pool->start[i]);
+    }
+
+    if (pool->done)
+        os_sem_destroy(pool->done);
+
+    pthread_mutex_destroy(&pool->run_lock);
+    memset(pool, 0, sizeof(WorkerPool));
+}
+
+void worker_pool_run(WorkerPool *pool, worker_fn fn, void *arg, int bands) {
+    if (bands > pool->count + 1)
+        bands = pool->count + 1;
+
+    if (bands <= 1 || pthread_mutex_trylock(&pool->run_lock) != 0) {
+        fn(arg, 0, 1);
+        return;
+    }
+
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->bands = bands;
+
+    // only wake the workers that have a band
+    const int wake = bands - 1;
+    for (int i = 0; i < wake; i++)
+        os_sem_post(pool->start[i]);
+
+    fn(arg, 0, bands);
+
+    for (int i = 0; i < wake; i++)
+        os_sem_wait(pool->done);
+
+    pthread_mutex_unlock(&pool->run_lock);
+}
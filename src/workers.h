@@ -0,0 +1,61 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <util/threading.h>
+#include "plugin.h"
+
+#define MAX_WORKERS 8
+
+// Where and how a plugin thread runs, from the output settings
+struct thread_policy {
+    int cpu;            // logical cpu to pin to, -1 = anywhere
+    int priority;       // 0 = normal scheduling, 1..99 = real time
+    bool round_robin;   // SCHED_RR rather than SCHED_FIFO
+};
+
+// Applies the policy to the calling thread, logging what did not take.
+// `task` is the MMCSS class on windows.
+void apply_thread_policy(const char *name, const thread_policy *policy, const char *task);
+
+// Adds the cpu the calling thread is on to *seen.
+// Only that thread writes *seen, anyone may read it.
+static inline void note_cpu(volatile uint64_t *seen) {
+    const int cpu = GetCurrentCpu();
+    if (cpu >= 0 && cpu < 64 && !(*seen & ((uint64_t) 1 << cpu)))
+        *seen |= (uint64_t) 1 << cpu;
+}
+
+// "0-3,6" from a note_cpu() mask, "?" if empty
+const char *format_cpus(char *buf, size_t size, uint64_t seen);
+
+// Persistent pool of pinned threads for splitting a frame into bands.
+// The calling thread always takes band 0, workers take the rest.
+typedef void (*worker_fn)(void *arg, int band, int bands);
+
+struct WorkerPool {
+    int count;
+    volatile bool quit;
+    pthread_t threads[MAX_WORKERS];
+    os_sem_t *start[MAX_WORKERS];
+    os_sem_t *done;
+    pthread_mutex_t run_lock;   // one frame at a time, the pool is shared
+    thread_policy policy;       // cpu is the first worker's, -1 = not pinned
+    volatile uint64_t cpus[MAX_WORKERS];   // see note_cpu()
+
+    // current job, written before the start semaphores are posted
+    worker_fn fn;
+    void *arg;
+    int bands;
+};
+
+// count == 0 picks a default from the number of cores.
+// With policy->cpu >= 0 the workers are pinned to consecutive cores from
+// there, otherwise the scheduler places them.
+bool worker_pool_init(WorkerPool *pool, int count, const thread_policy *policy);
+void worker_pool_destroy(WorkerPool *pool);
+
+// Run fn over `bands` bands and wait until all are done.
+// bands is capped to count + 1. If another caller has the pool, the
+// whole job runs on the calling thread instead of waiting for it.
+void worker_pool_run(WorkerPool *pool, worker_fn fn, void *arg, int bands);
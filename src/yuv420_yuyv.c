@@ -15,150 +15,883 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simd.h"
+#include "yuv420_yuyv.h"
 
-#if defined(__aarch64__) || defined(_M_ARM64)
-    #define HAVE_NEON 1
-    #include <arm_neon.h>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+typedef yuyv_pack_row_fn convert_row_fn;
+
+typedef void (*convert_row_nv12_fn)(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_uv, const int width, int stream);
+
+static int cpu_level_detected = -1;
+static int cpu_level_active = -1;
+
+// Without a detected size, assume a common desktop L3
+#define LLC_SIZE_FALLBACK ((size_t) 8 << 20)
 
-#elif defined(_MSC_VER)
-    /* MSVC */
-    #if defined(_M_AMD64) || defined(_M_X64) || \
-        (defined(_M_IX86_FP) && (_M_IX86_FP == 2))
-        #define HAVE_SSE2 1
-        #include <emmintrin.h>
+static size_t llc_size;
+static size_t stream_threshold;
+
+#if HAVE_AVX2
+static void cpuid(int leaf, int subleaf, unsigned regs[4]) {
+    #ifdef _MSC_VER
+    __cpuidex((int*) regs, leaf, subleaf);
+    #else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
     #endif
+}
 
-#elif defined(__x86_64__)
-    /* GCC / Clang */
-    #if defined(__SSE2__)
-        #define HAVE_SSE2 1
-        #include <x86intrin.h>
+static uint64_t xgetbv0(void) {
+    #ifdef _MSC_VER
+    return _xgetbv(0);
+    #else
+    unsigned eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t) edx << 32) | eax;
     #endif
+}
+
+static int detect_cpu_level(void) {
+    unsigned regs[4];
+    cpuid(0, 0, regs);
+    const unsigned max_leaf = regs[0];
 
+    cpuid(1, 0, regs);
+    const int osxsave = (regs[2] >> 27) & 1;
+    const int avx     = (regs[2] >> 28) & 1;
+    if (!osxsave || !avx || max_leaf < 7)
+        return CPU_LEVEL_SIMD128;
+
+    // the OS has to save the ymm (and zmm/opmask) state for us
+    const uint64_t xcr0 = xgetbv0();
+    if ((xcr0 & 0x6) != 0x6)
+        return CPU_LEVEL_SIMD128;
+
+    cpuid(7, 0, regs);
+    const int avx2     = (regs[1] >> 5) & 1;
+    const int avx512f  = (regs[1] >> 16) & 1;
+    const int avx512bw = (regs[1] >> 30) & 1;
+    if (!avx2)
+        return CPU_LEVEL_SIMD128;
+
+    if (avx512f && avx512bw && (xcr0 & 0xE6) == 0xE6)
+        return CPU_LEVEL_AVX512;
+
+    return CPU_LEVEL_AVX2;
+}
+#elif HAVE_SSE2 || HAVE_NEON
+static int detect_cpu_level(void) {
+    return CPU_LEVEL_SIMD128;
+}
+#else
+static int detect_cpu_level(void) {
+    return CPU_LEVEL_SCALAR;
+}
 #endif
 
-void map_yuv420_yuyv(uint8_t** data, uint32_t *linesize, uint8_t* dst,
-    int shift_x, int shift_y, int is_aligned_128b,
-    const int dest_width, const int dest_height,
-    const int width, const int height)
+// Size of the largest data or unified cache, 0 if the OS won't say
+static size_t detect_llc_size(void) {
+    size_t size = 0;
+
+    #if defined(_WIN32)
+    DWORD len = 0;
+    GetLogicalProcessorInformation(NULL, &len);
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION *info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION *) malloc(len);
+    if (info && GetLogicalProcessorInformation(info, &len)) {
+        int level = 0;
+        for (DWORD i = 0; i < len / sizeof(*info); i++) {
+            const CACHE_DESCRIPTOR *c = &info[i].Cache;
+            if (info[i].Relationship != RelationCache || c->Type == CacheInstruction)
+                continue;
+
+            if (c->Level > level || (c->Level == level && c->Size > size)) {
+                level = c->Level;
+                size = c->Size;
+            }
+        }
+    }
+    free(info);
+
+    #elif defined(__APPLE__)
+    // apple silicon reports no l3, its l2 is shared by a cluster
+    int64_t value = 0;
+    size_t value_len = sizeof(value);
+    if (sysctlbyname("hw.l3cachesize", &value, &value_len, NULL, 0) == 0 && value > 0)
+        size = (size_t) value;
+    else if (sysctlbyname("hw.l2cachesize", &value, &value_len, NULL, 0) == 0 && value > 0)
+        size = (size_t) value;
+
+    #elif defined(__linux__)
+    // sysfs has the size of one cache instance, the one our threads share
+    int level = 0;
+    for (int index = 0; index < 16; index++) {
+        char path[96], type[32];
+        int this_level = 0;
+        unsigned long kb = 0;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        FILE *f = fopen(path, "r");
+        if (!f)
+            break;
+        int ok = fscanf(f, "%31s", type) == 1;
+        fclose(f);
+        if (!ok || strcmp(type, "Instruction") == 0)
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        if ((f = fopen(path, "r")) != NULL) {
+            if (fscanf(f, "%d", &this_level) != 1) this_level = 0;
+            fclose(f);
+        }
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        if ((f = fopen(path, "r")) != NULL) {
+            if (fscanf(f, "%luK", &kb) != 1) kb = 0;
+            fclose(f);
+        }
+
+        if (this_level > level && kb) {
+            level = this_level;
+            size = (size_t) kb << 10;
+        }
+    }
+    #endif
+
+    return size;
+}
+
+int yuyv_cpu_init(void) {
+    if (cpu_level_detected < 0) {
+        cpu_level_detected = detect_cpu_level();
+
+        // avx512 measured no faster than avx2 here and slower in places
+        // (downclocking, the masked tails), it has to be asked for
+        cpu_level_active = cpu_level_detected < CPU_LEVEL_AVX2
+            ? cpu_level_detected : CPU_LEVEL_AVX2;
+
+        // a frame over half the cache is evicted before the consumer
+        // gets to it, source planes and other threads take the rest
+        llc_size = detect_llc_size();
+        stream_threshold = (llc_size ? llc_size : LLC_SIZE_FALLBACK) / 2;
+    }
+    return cpu_level_active;
+}
+
+size_t yuyv_llc_size(void) {
+    yuyv_cpu_init();
+    return llc_size;
+}
+
+size_t yuyv_stream_threshold(void) {
+    yuyv_cpu_init();
+    return stream_threshold;
+}
+
+size_t yuyv_set_stream_threshold(size_t bytes) {
+    yuyv_cpu_init();
+    const size_t prev = stream_threshold;
+    stream_threshold = bytes;
+    return prev;
+}
+
+int yuyv_use_stream(size_t frame_bytes) {
+    yuyv_cpu_init();
+    return frame_bytes >= stream_threshold;
+}
+
+int yuyv_cpu_level(void) {
+    return cpu_level_active < 0 ? yuyv_cpu_init() : cpu_level_active;
+}
+
+int yuyv_set_cpu_level(int level) {
+    yuyv_cpu_init();
+    if (level < CPU_LEVEL_SCALAR) level = CPU_LEVEL_SCALAR;
+    cpu_level_active = level < cpu_level_detected ? level : cpu_level_detected;
+    return cpu_level_active;
+}
+
+const char *yuyv_cpu_level_name(int level) {
+    switch (level) {
+    case CPU_LEVEL_SIMD128:
+        #if HAVE_NEON
+        return "neon";
+        #else
+        return "sse2";
+        #endif
+    case CPU_LEVEL_AVX2:
+        return "avx2";
+    case CPU_LEVEL_AVX512:
+        return "avx512bw";
+    default:
+        return "scalar";
+    }
+}
+
+static void convert_row_scalar(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream)
 {
-    uint8_t* src_y = data[0];
-    uint8_t* src_u = data[1];
-    uint8_t* src_v = data[2];
-    const int linesize_dst = width<<1;
-    int shift_x2;
-    (void) dest_height;
+    (void) stream;
+    for (int x = 0; x < (width>>1); x++) {
+        *dst++ = *src_y++;
+        *dst++ = *src_u++;
+        *dst++ = *src_y++;
+        *dst++ = *src_v++;
+    }
+    if (width & 1) {
+        *dst++ = *src_y;
+        *dst++ = *src_u;
+    }
+}
 
-    // dst can only shift in even amounts, pixels come in pairs: yu-yv
-    // in case of odd pixel shifts, we need separate left & right shift amounts
-    if (shift_x) {
-        shift_x2 = dest_width - width - shift_x;
-        shift_x  <<= 1;
-        shift_x2 <<= 1;
+// The SIMD rows convert as many full vectors as fit in the width and
+// hand the remainder to the next narrower kernel, so only the last few
+// pixels of a row are ever scalar. Streaming stores are used when the
+// caller asks for them (see yuyv_use_stream) and dst is aligned to the
+// vector size, which is not a given with shift_x or odd webcam widths.
+// Loads are unaligned: the tail kernels start mid-row.
+
+#define CONVERT_TAIL(next, body) \
+    if (width > body) \
+        next(dst + (body<<1), src_y + body, src_u + (body>>1), src_v + (body>>1), width - body, stream)
+
+#if HAVE_SSE2
+static void convert_row_sse2(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream)
+{
+    const int body = width & ~15;
+
+    #define CONVERT_ROW(STORE) \
+    for (int x = 0; x < body; x += 16) {        \
+        __m128i y = _mm_loadu_si128((__m128i*)(src_y + x));   \
+        __m128i u = _mm_loadl_epi64((__m128i*)(src_u + (x>>1))); \
+        __m128i v = _mm_loadl_epi64((__m128i*)(src_v + (x>>1))); \
+        \
+        __m128i uv = _mm_unpacklo_epi8(u, v);                 \
+        __m128i yuv0 = _mm_unpacklo_epi8(y, uv);              \
+        __m128i yuv1 = _mm_unpackhi_epi8(y, uv);              \
+        STORE((__m128i*)(dst + (x<<1)), yuv0);      \
+        STORE((__m128i*)(dst + (x<<1) + 16), yuv1); \
     }
 
-    if (shift_y) {
-        dst += (shift_y * dest_width) << 1;
+    if (stream && ((uintptr_t) dst & 15) == 0) {
+        CONVERT_ROW(_mm_stream_si128)
+    } else {
+        CONVERT_ROW(_mm_storeu_si128)
     }
+    #undef CONVERT_ROW
+
+    CONVERT_TAIL(convert_row_scalar, body);
+}
+#endif
+
+#if HAVE_AVX2
+TARGET_AVX2
+static void convert_row_avx2(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream)
+{
+    const int body = width & ~31;
+
+    // 32 pixels per iteration. The 256-bit unpacks work per 128-bit lane,
+    // so uv is laid out lane-wise and the halves are swapped back on store.
+    #define CONVERT_ROW(STORE) \
+    for (int x = 0; x < body; x += 32) {        \
+        __m256i y = _mm256_loadu_si256((__m256i*)(src_y + x));   \
+        __m128i u = _mm_loadu_si128((__m128i*)(src_u + (x>>1))); \
+        __m128i v = _mm_loadu_si128((__m128i*)(src_v + (x>>1))); \
+        \
+        __m256i uv = _mm256_inserti128_si256(                    \
+            _mm256_castsi128_si256(_mm_unpacklo_epi8(u, v)),     \
+            _mm_unpackhi_epi8(u, v), 1);                         \
+        __m256i lo = _mm256_unpacklo_epi8(y, uv);                \
+        __m256i hi = _mm256_unpackhi_epi8(y, uv);                \
+        STORE((__m256i*)(dst + (x<<1)),      _mm256_permute2x128_si256(lo, hi, 0x20)); \
+        STORE((__m256i*)(dst + (x<<1) + 32), _mm256_permute2x128_si256(lo, hi, 0x31)); \
+    }
+
+    if (stream && ((uintptr_t) dst & 31) == 0) {
+        CONVERT_ROW(_mm256_stream_si256)
+    } else {
+        CONVERT_ROW(_mm256_storeu_si256)
+    }
+    #undef CONVERT_ROW
+
+    CONVERT_TAIL(convert_row_sse2, body);
+}
+
+TARGET_AVX512
+static void convert_row_avx512(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream)
+{
+    const int body = width & ~63;
+
+    // 64 pixels per iteration, same lane juggling as avx2 over four lanes
+    const __m512i idx0 = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    const __m512i idx1 = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+
+    #define CONVERT_BLOCK(y, u, v, out0, out1) \
+        __m512i uv = _mm512_inserti64x4(                         \
+            _mm512_castsi256_si512(_mm256_unpacklo_epi8(u, v)),  \
+            _mm256_unpackhi_epi8(u, v), 1);                      \
+        uv = _mm512_shuffle_i64x2(uv, uv, _MM_SHUFFLE(3,1,2,0)); \
+        __m512i lo = _mm512_unpacklo_epi8(y, uv);                \
+        __m512i hi = _mm512_unpackhi_epi8(y, uv);                \
+        __m512i out0 = _mm512_permutex2var_epi64(lo, idx0, hi);  \
+        __m512i out1 = _mm512_permutex2var_epi64(lo, idx1, hi);
+
+    #define CONVERT_ROW(STORE) \
+    for (int x = 0; x < body; x += 64) {        \
+        __m512i y = _mm512_loadu_si512((void*)(src_y + x));      \
+        __m256i u = _mm256_loadu_si256((__m256i*)(src_u + (x>>1))); \
+        __m256i v = _mm256_loadu_si256((__m256i*)(src_v + (x>>1))); \
+        CONVERT_BLOCK(y, u, v, out0, out1)                       \
+        STORE((void*)(dst + (x<<1)),      out0); \
+        STORE((void*)(dst + (x<<1) + 64), out1); \
+    }
+
+    if (stream && ((uintptr_t) dst & 63) == 0) {
+        CONVERT_ROW(_mm512_stream_si512)
+    } else {
+        CONVERT_ROW(_mm512_storeu_si512)
+    }
+    #undef CONVERT_ROW
+
+    // masked epilogue, nothing outside the row is read or written
+    const int tail = width - body;
+    if (tail) {
+        const __mmask64 y_mask  = (1ULL << tail) - 1;
+        const __mmask64 uv_mask = (1ULL << ((tail + 1) >> 1)) - 1;
+        const __mmask64 lo_mask = tail >= 32 ? ~0ULL : (1ULL << (tail<<1)) - 1;
+        const __mmask64 hi_mask = tail > 32 ? (1ULL << ((tail<<1) - 64)) - 1 : 0;
+
+        __m512i y = _mm512_maskz_loadu_epi8(y_mask, src_y + body);
+        __m256i u = _mm512_castsi512_si256(_mm512_maskz_loadu_epi8(uv_mask, src_u + (body>>1)));
+        __m256i v = _mm512_castsi512_si256(_mm512_maskz_loadu_epi8(uv_mask, src_v + (body>>1)));
+        CONVERT_BLOCK(y, u, v, out0, out1)
+        _mm512_mask_storeu_epi8(dst + (body<<1),      lo_mask, out0);
+        _mm512_mask_storeu_epi8(dst + (body<<1) + 64, hi_mask, out1);
+    }
+    #undef CONVERT_BLOCK
+}
+#endif
+
+#if HAVE_NEON
+static void convert_row_neon(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream)
+{
+    (void) stream;
+    const int body = width & ~15;
+
+    for (int x = 0; x < body; x += 16) {
+        uint8x16_t yq = vld1q_u8(src_y + x);
+        uint8x8_t u8  = vld1_u8(src_u + (x >> 1));
+        uint8x8_t v8  = vld1_u8(src_v + (x >> 1));
+        /*interleave u and v */
+        uint8x8x2_t uvz = vzip_u8(u8, v8);
+        /* combine into one 16-byte vector */
+        uint8x16_t uvq = vcombine_u8(uvz.val[0], uvz.val[1]);
+        /* interleave Y and UV bytes */
+        uint8x16x2_t yuv = vzipq_u8(yq, uvq);
+        vst1q_u8(dst + (x << 1),      yuv.val[0]);
+        vst1q_u8(dst + (x << 1) + 16, yuv.val[1]);
+    }
+
+    CONVERT_TAIL(convert_row_scalar, body);
+}
+#endif
+
+static convert_row_fn select_row_fn(void) {
+    const int level = yuyv_cpu_level();
+
+    #if HAVE_AVX2
+    if (level >= CPU_LEVEL_AVX512)
+        return convert_row_avx512;
+
+    if (level >= CPU_LEVEL_AVX2)
+        return convert_row_avx2;
+    #endif
 
-    // Each row N and N+1 use the same UV values (4:2:0 -> 4:2:2)
     #if HAVE_SSE2
-    if (is_aligned_128b)
-    {
-        for (int y = 0; y < (height>>1); ++y) {
-            #define CONVERT_ROW \
-            if (shift_x) dst += shift_x; \
-            for (int x = 0; x < width; x += 16) {        \
-                __m128i y = _mm_load_si128((__m128i*)(src_y + x));    \
-                __m128i u = _mm_loadl_epi64((__m128i*)(src_u + (x>>1))); \
-                __m128i v = _mm_loadl_epi64((__m128i*)(src_v + (x>>1))); \
-                \
-                __m128i uv = _mm_unpacklo_epi8(u, v);                 \
-                __m128i yuv0 = _mm_unpacklo_epi8(y, uv);              \
-                __m128i yuv1 = _mm_unpackhi_epi8(y, uv);              \
-                _mm_stream_si128((__m128i*)(dst + (x<<1)), yuv0);      \
-                _mm_stream_si128((__m128i*)(dst + (x<<1) + 16), yuv1); \
-            } \
-            if (shift_x) dst += shift_x2;
-
-            CONVERT_ROW
-            dst += linesize_dst;
-            src_y += linesize[0];
-
-            CONVERT_ROW
-            dst += linesize_dst;
-            src_y += linesize[0];
-            src_u += linesize[1];
-            src_v += linesize[2];
-        }
+    if (level >= CPU_LEVEL_SIMD128)
+        return convert_row_sse2;
+    #elif HAVE_NEON
+    if (level >= CPU_LEVEL_SIMD128)
+        return convert_row_neon;
+    #else
+    (void) level;
+    #endif
 
-        return;
+    return convert_row_scalar;
+}
+
+// NV12 already has u and v interleaved in the order yuyv wants them,
+// so a row is a plain byte zip of y and uv.
+
+static void convert_row_nv12_scalar(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_uv, const int width, int stream)
+{
+    (void) stream;
+    for (int x = 0; x < (width>>1); x++) {
+        *dst++ = *src_y++;
+        *dst++ = *src_uv++;
+        *dst++ = *src_y++;
+        *dst++ = *src_uv++;
+    }
+    if (width & 1) {
+        *dst++ = *src_y;
+        *dst++ = *src_uv;
+    }
+}
+
+#define CONVERT_TAIL_NV12(next, body) \
+    if (width > body) \
+        next(dst + (body<<1), src_y + body, src_uv + body, width - body, stream)
+
+#if HAVE_SSE2
+static void convert_row_nv12_sse2(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_uv, const int width, int stream)
+{
+    const int body = width & ~15;
+
+    #define CONVERT_ROW(STORE) \
+    for (int x = 0; x < body; x += 16) {        \
+        __m128i y  = _mm_loadu_si128((__m128i*)(src_y + x));  \
+        __m128i uv = _mm_loadu_si128((__m128i*)(src_uv + x)); \
+        STORE((__m128i*)(dst + (x<<1)),      _mm_unpacklo_epi8(y, uv)); \
+        STORE((__m128i*)(dst + (x<<1) + 16), _mm_unpackhi_epi8(y, uv)); \
+    }
+
+    if (stream && ((uintptr_t) dst & 15) == 0) {
+        CONVERT_ROW(_mm_stream_si128)
+    } else {
+        CONVERT_ROW(_mm_storeu_si128)
+    }
+    #undef CONVERT_ROW
+
+    CONVERT_TAIL_NV12(convert_row_nv12_scalar, body);
+}
+#endif
+
+#if HAVE_AVX2
+TARGET_AVX2
+static void convert_row_nv12_avx2(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_uv, const int width, int stream)
+{
+    const int body = width & ~31;
+
+    // the unpacks stay within 128-bit lanes, swap the halves back on store
+    #define CONVERT_ROW(STORE) \
+    for (int x = 0; x < body; x += 32) {        \
+        __m256i y  = _mm256_loadu_si256((__m256i*)(src_y + x));  \
+        __m256i uv = _mm256_loadu_si256((__m256i*)(src_uv + x)); \
+        __m256i lo = _mm256_unpacklo_epi8(y, uv);                \
+        __m256i hi = _mm256_unpackhi_epi8(y, uv);                \
+        STORE((__m256i*)(dst + (x<<1)),      _mm256_permute2x128_si256(lo, hi, 0x20)); \
+        STORE((__m256i*)(dst + (x<<1) + 32), _mm256_permute2x128_si256(lo, hi, 0x31)); \
+    }
+
+    if (stream && ((uintptr_t) dst & 31) == 0) {
+        CONVERT_ROW(_mm256_stream_si256)
+    } else {
+        CONVERT_ROW(_mm256_storeu_si256)
+    }
+    #undef CONVERT_ROW
+
+    CONVERT_TAIL_NV12(convert_row_nv12_sse2, body);
+}
+#endif
+
+#if HAVE_NEON
+static void convert_row_nv12_neon(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_uv, const int width, int stream)
+{
+    (void) stream;
+    const int body = width & ~15;
+
+    for (int x = 0; x < body; x += 16) {
+        uint8x16_t yq  = vld1q_u8(src_y + x);
+        uint8x16_t uvq = vld1q_u8(src_uv + x);
+        uint8x16x2_t yuv = vzipq_u8(yq, uvq);
+        vst1q_u8(dst + (x << 1),      yuv.val[0]);
+        vst1q_u8(dst + (x << 1) + 16, yuv.val[1]);
+    }
+
+    CONVERT_TAIL_NV12(convert_row_nv12_scalar, body);
+}
+#endif
+
+// avx512 has no nv12 kernel, a zip is store bound and avx2 keeps up
+static convert_row_nv12_fn select_row_nv12_fn(void) {
+    const int level = yuyv_cpu_level();
+
+    #if HAVE_AVX2
+    if (level >= CPU_LEVEL_AVX2)
+        return convert_row_nv12_avx2;
+    #endif
+
+    #if HAVE_SSE2
+    if (level >= CPU_LEVEL_SIMD128)
+        return convert_row_nv12_sse2;
+    #elif HAVE_NEON
+    if (level >= CPU_LEVEL_SIMD128)
+        return convert_row_nv12_neon;
+    #else
+    (void) level;
+    #endif
+
+    return convert_row_nv12_scalar;
+}
+
+// UYVY is the NV12 zip with the inputs swapped, uv first. From I420 the
+// u and v rows are zipped into a small buffer first, a chunk at a time
+// so it stays in L1.
+#define UYVY_CHUNK 1024
+
+static void zip_uv(uint8_t *dst, const uint8_t *src_u, const uint8_t *src_v, const int count) {
+    int x = 0;
+    #if HAVE_SSE2
+    for (; x + 16 <= count; x += 16) {
+        __m128i u = _mm_loadu_si128((__m128i*)(src_u + x));
+        __m128i v = _mm_loadu_si128((__m128i*)(src_v + x));
+        _mm_storeu_si128((__m128i*)(dst + (x<<1)),      _mm_unpacklo_epi8(u, v));
+        _mm_storeu_si128((__m128i*)(dst + (x<<1) + 16), _mm_unpackhi_epi8(u, v));
     }
     #elif HAVE_NEON
-    if (is_aligned_128b)
-    {
-        for (int y = 0; y < (height>>1); ++y) {
-            #define CONVERT_ROW \
-            if (shift_x) dst += shift_x; \
-            for (int x = 0; x < width; x += 16) {    \
-                uint8x16_t yq = vld1q_u8(src_y + x); \
-                uint8x8_t u8  = vld1_u8(src_u + (x >> 1)); \
-                uint8x8_t v8  = vld1_u8(src_v + (x >> 1)); \
-                /*interleave u and v */       \
-                uint8x8x2_t uvz = vzip_u8(u8, v8);   \
-                /* combine into one 16-byte vector */  \
-                uint8x16_t uvq = vcombine_u8(uvz.val[0], uvz.val[1]); \
-                /* interleave Y and UV bytes */       \
-                uint8x16x2_t yuv = vzipq_u8(yq, uvq); \
-                vst1q_u8(dst + (x << 1),      yuv.val[0]); \
-                vst1q_u8(dst + (x << 1) + 16, yuv.val[1]); \
-            } \
-            if (shift_x) dst += shift_x2;
-
-            CONVERT_ROW
-            dst += linesize_dst;
-            src_y += linesize[0];
-
-            CONVERT_ROW
-            dst += linesize_dst;
-            src_y += linesize[0];
-            src_u += linesize[1];
-            src_v += linesize[2];
+    for (; x + 16 <= count; x += 16) {
+        uint8x16x2_t uv = { { vld1q_u8(src_u + x), vld1q_u8(src_v + x) } };
+        vst2q_u8(dst + (x<<1), uv);
+    }
+    #endif
+    for (; x < count; x++) {
+        dst[(x<<1)]     = src_u[x];
+        dst[(x<<1) + 1] = src_v[x];
+    }
+}
+
+static void convert_row_uyvy(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream)
+{
+    uint8_t uv[UYVY_CHUNK + 2];
+    convert_row_nv12_fn convert_row = select_row_nv12_fn();
+
+    for (int x = 0; x < width; x += UYVY_CHUNK) {
+        const int n = (width - x) < UYVY_CHUNK ? (width - x) : UYVY_CHUNK;
+        zip_uv(uv, src_u + (x>>1), src_v + (x>>1), (n + 1) >> 1);
+        convert_row(dst + (x<<1), uv, src_y + x, n, stream);
+    }
+}
+
+yuyv_pack_row_fn yuyv_select_pack_row(int order) {
+    return order == ORDER_UYVY ? convert_row_uyvy : select_row_fn();
+}
+
+static void map_planar_rows(convert_row_fn convert_row,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end)
+{
+    const int linesize_dst = dest_width<<1;
+    const int stream = yuyv_use_stream((size_t) linesize_dst * dest_height);
+
+    // bands have to start on a row pair so the chroma rows line up
+    row_start &= ~1;
+    if (row_end > height) row_end = height;
+
+    uint8_t* src_y = data[0] + row_start * linesize[0];
+    uint8_t* src_u = data[1] + (row_start>>1) * linesize[1];
+    uint8_t* src_v = data[2] + (row_start>>1) * linesize[2];
+
+    // dst can only shift in even amounts, pixels come in pairs: yu-yv.
+    // An odd shift is rounded down, the right border absorbs the extra pixel.
+    shift_x &= ~1;
+    dst += ((shift_y + row_start) * linesize_dst) + (shift_x<<1);
+
+    // Each row N and N+1 use the same UV values (4:2:0 -> 4:2:2)
+    for (int y = row_start; y < (row_end & ~1); y += 2) {
+        convert_row(dst, src_y, src_u, src_v, width, stream);
+        dst += linesize_dst;
+        src_y += linesize[0];
+
+        convert_row(dst, src_y, src_u, src_v, width, stream);
+        dst += linesize_dst;
+        src_y += linesize[0];
+        src_u += linesize[1];
+        src_v += linesize[2];
+    }
+
+    #if HAVE_SSE2
+    // order the streaming stores before the frame is handed over,
+    // each thread has to fence its own
+    _mm_sfence();
+    #endif
+    return;
+}
+
+static void map_nv12_rows(int order,
+    uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end)
+{
+    const int linesize_dst = dest_width<<1;
+    const int stream = yuyv_use_stream((size_t) linesize_dst * dest_height);
+
+    row_start &= ~1;
+    if (row_end > height) row_end = height;
+
+    uint8_t* src_y  = data[0] + row_start * linesize[0];
+    uint8_t* src_uv = data[1] + (row_start>>1) * linesize[1];
+
+    shift_x &= ~1;
+    dst += ((shift_y + row_start) * linesize_dst) + (shift_x<<1);
+
+    convert_row_nv12_fn convert_row = select_row_nv12_fn();
+
+    // the kernel zips two byte rows, the order picks yuyv or uyvy
+    for (int y = row_start; y < (row_end & ~1); y += 2) {
+        const uint8_t *first  = order == ORDER_UYVY ? src_uv : src_y;
+        const uint8_t *second = order == ORDER_UYVY ? src_y : src_uv;
+        convert_row(dst, first, second, width, stream);
+        dst += linesize_dst;
+        src_y += linesize[0];
+
+        first  = order == ORDER_UYVY ? src_uv : src_y;
+        second = order == ORDER_UYVY ? src_y : src_uv;
+        convert_row(dst, first, second, width, stream);
+        dst += linesize_dst;
+        src_y += linesize[0];
+        src_uv += linesize[1];
+    }
+
+    #if HAVE_SSE2
+    _mm_sfence();
+    #endif
+}
+
+void map_yuv420_yuyv_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end)
+{
+    map_planar_rows(select_row_fn(), data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, width, height, row_start, row_end);
+}
+
+void map_yuv420_uyvy_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end)
+{
+    map_planar_rows(convert_row_uyvy, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, width, height, row_start, row_end);
+}
+
+void map_yuv420_yuyv(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height)
+{
+    map_yuv420_yuyv_rows(data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, width, height, 0, height);
+}
+
+void map_nv12_yuyv_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end)
+{
+    map_nv12_rows(ORDER_YUYV, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, width, height, row_start, row_end);
+}
+
+void map_nv12_uyvy_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end)
+{
+    map_nv12_rows(ORDER_UYVY, data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, width, height, row_start, row_end);
+}
+
+void map_nv12_yuyv(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height)
+{
+    map_nv12_yuyv_rows(data, linesize, dst, shift_x, shift_y,
+        dest_width, dest_height, width, height, 0, height);
+}
+
+// Plain copy, with `stream` streaming stores for the aligned middle of each row
+static void stream_copy(uint8_t *dst, const uint8_t *src, size_t bytes, int stream) {
+    #if HAVE_SSE2
+    if (stream && yuyv_cpu_level() >= CPU_LEVEL_SIMD128 && bytes >= 128) {
+        const size_t head = (16 - ((uintptr_t) dst & 15)) & 15;
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        bytes -= head;
+
+        for (; bytes >= 64; bytes -= 64, dst += 64, src += 64) {
+            __m128i a = _mm_loadu_si128((__m128i*)(src +  0));
+            __m128i b = _mm_loadu_si128((__m128i*)(src + 16));
+            __m128i c = _mm_loadu_si128((__m128i*)(src + 32));
+            __m128i d = _mm_loadu_si128((__m128i*)(src + 48));
+            _mm_stream_si128((__m128i*)(dst +  0), a);
+            _mm_stream_si128((__m128i*)(dst + 16), b);
+            _mm_stream_si128((__m128i*)(dst + 32), c);
+            _mm_stream_si128((__m128i*)(dst + 48), d);
         }
+    }
+    #else
+    (void) stream;
+    #endif
+    memcpy(dst, src, bytes);
+}
 
+void copy_plane_rows(uint8_t *dst, int dst_linesize,
+    const uint8_t *src, int src_linesize, int bytes, int rows, int stream)
+{
+    if (rows <= 0 || bytes <= 0)
         return;
+
+    // whole plane in one go when neither side has padding
+    if (dst_linesize == bytes && src_linesize == bytes) {
+        stream_copy(dst, src, (size_t) bytes * rows, stream);
+    }
+    else {
+        for (int y = 0; y < rows; y++) {
+            stream_copy(dst, src, bytes, stream);
+            dst += dst_linesize;
+            src += src_linesize;
+        }
     }
-    #else // not __SSE2__
-    (void) is_aligned_128b;
+
+    #if HAVE_SSE2
+    _mm_sfence();
     #endif
+}
 
-    #undef CONVERT_ROW
-    for (int y = 0; y < (height>>1); y++) {
-        #define CONVERT_ROW \
-        if (shift_x) dst += shift_x; \
-        for (int x = 0; x < (width>>1); x++) { \
-            *dst++ = *src_y++; \
-            *dst++ = *src_u++; \
-            *dst++ = *src_y++; \
-            *dst++ = *src_v++; \
-        } \
-        if (shift_x) dst += shift_x2;
-
-        uint8_t* src_u0 = src_u;
-        uint8_t* src_v0 = src_v;
-        CONVERT_ROW
-
-        src_u = src_u0;
-        src_v = src_v0;
-        CONVERT_ROW
+void clear_plane_borders(uint8_t *dst, const int linesize, const int plane_width, const int plane_height,
+    int shift_x, int shift_y, const int width, const int height, uint8_t value)
+{
+    int right = shift_x + width;
+    if (right > plane_width) right = plane_width;
+
+    int bottom = shift_y + height;
+    if (bottom > plane_height) bottom = plane_height;
+
+    for (int y = 0; y < plane_height; y++) {
+        uint8_t *row = dst + ((size_t) y * linesize);
+        if (y < shift_y || y >= bottom) {
+            memset(row, value, plane_width);
+            continue;
+        }
+        if (shift_x > 0)
+            memset(row, value, shift_x);
+        if (right < plane_width)
+            memset(row + right, value, plane_width - right);
     }
+}
 
-    return;
+// Fill with a repeated 4-byte yuyv pair, streaming stores for the bulk.
+// dst and bytes are multiples of 4, like everything in a yuyv frame.
+// Streaming stores only pay off for whole cache lines, the short
+// pillarbox bars go through the cache instead.
+static void fill_yuyv(uint8_t* dst, size_t bytes, uint32_t color, int stream) {
+    uint32_t* ptr = (uint32_t*)dst;
+    size_t count = bytes >> 2;
+    (void) stream;
+
+    #if HAVE_SSE2 || HAVE_NEON
+    while (count && ((uintptr_t) ptr & 15)) {
+        *ptr++ = color;
+        count--;
+    }
+
+    #if HAVE_SSE2
+    const __m128i fill = _mm_set1_epi32((int) color);
+    if (stream) {
+        for (; count >= 16; count -= 16, ptr += 16) {
+            _mm_stream_si128((__m128i*)(ptr +  0), fill);
+            _mm_stream_si128((__m128i*)(ptr +  4), fill);
+            _mm_stream_si128((__m128i*)(ptr +  8), fill);
+            _mm_stream_si128((__m128i*)(ptr + 12), fill);
+        }
+    }
+    for (; count >= 4; count -= 4, ptr += 4)
+        _mm_store_si128((__m128i*) ptr, fill);
+    #else
+    const uint32x4_t fill = vdupq_n_u32(color);
+    for (; count >= 16; count -= 16, ptr += 16) {
+        vst1q_u32(ptr +  0, fill);
+        vst1q_u32(ptr +  4, fill);
+        vst1q_u32(ptr +  8, fill);
+        vst1q_u32(ptr + 12, fill);
+    }
+    #endif
+    #endif
+
+    while (count--)
+        *ptr++ = color;
 }
 
 void clear_yuyv(uint8_t* dst, int size, int color) {
-    int* ptr = (int*)dst;
-    for (int i = 0; i < size / sizeof(int); i++) {
-        *ptr++ = color;
+    fill_yuyv(dst, (size_t) size & ~(size_t)3, (uint32_t) color, yuyv_use_stream((size_t) size));
+
+    #if HAVE_SSE2
+    _mm_sfence();
+    #endif
+}
+
+void clear_yuyv_borders(uint8_t* dst, const int dest_width, const int dest_height,
+    int shift_x, int shift_y, const int width, const int height, int color)
+{
+    const size_t linesize_dst = (size_t) dest_width<<1;
+    const int stream = yuyv_use_stream(linesize_dst * dest_height);
+
+    // same rounding as the conversion: the image starts on a pixel pair,
+    // and the bar covers the half pair of an odd width so its V is defined
+    shift_x &= ~1;
+    int right = shift_x + (width & ~1);
+    if (right > dest_width) right = dest_width;
+
+    int bottom = shift_y + height;
+    if (bottom > dest_height) bottom = dest_height;
+
+    if (shift_y > 0)
+        fill_yuyv(dst, shift_y * linesize_dst, (uint32_t) color, stream);
+
+    if (shift_x > 0 || right < dest_width) {
+        for (int y = shift_y; y < bottom; y++) {
+            uint8_t *row = dst + (y * linesize_dst);
+            if (shift_x > 0)
+                fill_yuyv(row, (size_t) shift_x<<1, (uint32_t) color, 0);
+            if (right < dest_width)
+                fill_yuyv(row + (right<<1), (size_t)(dest_width - right)<<1, (uint32_t) color, 0);
+        }
     }
+
+    if (bottom < dest_height)
+        fill_yuyv(dst + (bottom * linesize_dst), (dest_height - bottom) * linesize_dst, (uint32_t) color, stream);
+
+    #if HAVE_SSE2
+    _mm_sfence();
+    #endif
 }
@@ -0,0 +1,112 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Widest vector unit used by the conversion kernels,
+ * picked at load time from cpuid (x86) or at compile time (arm).
+ * The default stops at AVX2, AVX-512 is opt-in via yuyv_set_cpu_level */
+enum cpu_level {
+    CPU_LEVEL_SCALAR = 0,
+    CPU_LEVEL_SIMD128,  // SSE2 or NEON
+    CPU_LEVEL_AVX2,
+    CPU_LEVEL_AVX512,   // AVX-512 F + BW
+};
+
+int yuyv_cpu_init(void);
+int yuyv_cpu_level(void);
+const char *yuyv_cpu_level_name(int level);
+
+// Set the level used by the kernels, capped to what the cpu has.
+// Returns the level actually in effect.
+int yuyv_set_cpu_level(int level);
+
+// Streaming (non-temporal) stores skip the cache. That pays off for
+// frames too big to still be cached when the consumer reads them, and
+// costs a trip to memory for frames that would have been. Frames of at
+// least yuyv_stream_threshold() bytes are streamed, half the last level
+// cache by default. NEON builds always store through the cache.
+size_t yuyv_llc_size(void);         // 0 if unknown
+size_t yuyv_stream_threshold(void);
+int yuyv_use_stream(size_t frame_bytes);
+
+// Override the threshold, mainly for benchmarks: 0 always streams,
+// SIZE_MAX never does. Returns the previous value.
+size_t yuyv_set_stream_threshold(size_t bytes);
+
+void map_yuv420_yuyv(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height);
+
+// Convert rows [row_start, row_end) only, for splitting a frame into bands.
+// row_start is rounded down to a row pair.
+void map_yuv420_yuyv_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end);
+
+// Same for NV12, data[1] is the interleaved uv plane
+void map_nv12_yuyv(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height);
+
+void map_nv12_yuyv_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end);
+
+// Byte order of the packed 4:2:2 output
+enum packed_order {
+    ORDER_YUYV = 0,
+    ORDER_UYVY,
+};
+
+// UYVY variants of the above, same arguments
+void map_yuv420_uyvy_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end);
+
+void map_nv12_uyvy_rows(uint8_t** data, uint32_t *linesize, uint8_t* dst,
+    int shift_x, int shift_y,
+    const int dest_width, const int dest_height,
+    const int width, const int height,
+    int row_start, int row_end);
+
+// One row of planar y, u, v (u and v at half width) into yuyv or uyvy.
+// With `stream` streaming stores may be used, callers fence with
+// _mm_sfence when done.
+typedef void (*yuyv_pack_row_fn)(uint8_t *dst, const uint8_t *src_y,
+    const uint8_t *src_u, const uint8_t *src_v, const int width, int stream);
+
+// The row kernel for the active cpu level
+yuyv_pack_row_fn yuyv_select_pack_row(int order);
+
+// Copy `rows` rows of `bytes` each, for formats that need no conversion.
+// With `stream` streaming stores, fenced before returning.
+void copy_plane_rows(uint8_t *dst, int dst_linesize,
+    const uint8_t *src, int src_linesize, int bytes, int rows, int stream);
+
+// clear_yuyv_borders for one plane of a planar format, in bytes
+void clear_plane_borders(uint8_t *dst, const int linesize, const int plane_width, const int plane_height,
+    int shift_x, int shift_y, const int width, const int height, uint8_t value);
+
+void clear_yuyv(uint8_t* dst, int size, int color);
+
+// Fill only the letterbox/pillarbox bars around a width x height image
+// placed at shift_x, shift_y, the part the conversion never writes.
+void clear_yuyv_borders(uint8_t* dst, const int dest_width, const int dest_height,
+    int shift_x, int shift_y, const int width, const int height, int color);
+
+#ifdef __cplusplus
+} // "C"
+#endif
@@ -0,0 +1,420 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Reference consumer: does what the DroidCam webcam drivers do with the
+// shared memory, so the output can be tested end to end without them.
+//
+// Build against the libobs headers (only the inline atomics are used,
+// no need to link libobs), e.g.
+//   c++ -O2 -std=c++17 -I<obs-studio>/libobs -o consumer tools/consumer.cc src/sys-posix.cc -lpthread
+//   cl /O2 /std:c++17 /I<obs-studio>\libobs tools\consumer.cc src\sys-win.cc
+//
+// Usage: consumer [options]
+//   -i n        output instance, 0..MAX_INSTANCES-1 (0)
+//   -s WxH      webcam size (1280x720)
+//   -r fps      webcam frame rate (30)
+//   -f format   yuy2, uyvy, nv12 or i420 (yuy2)
+//   -b slots    1 = single buffer with the Wr/Rd events, 3 = frame slots (3)
+//   -c fps      read cadence, when it should differ from -r
+//   -a rate     audio sample rate (48000)
+//   -n ch       audio channels (2)
+//   -k frames   audio chunk frames, 0 = plugin default (0)
+//   -p format   s16, s24 or f32 (s16)
+//   -t sec      run time, 0 = until Ctrl+C or SIGTERM (10)
+//   -V, -A      no video, no audio
+//
+// Once a second it prints delivered fps, duplicate and torn frames, audio
+// chunks and underruns, and the OBS timestamp to read latency. The totals
+// and latency percentiles are printed at the end, also when stopped by a
+// signal. Latencies go into the plugin's fixed size histograms, so a soak
+// run takes no more memory the longer it goes; percentiles are bucket
+// upper bounds, off by less than 1/16.
+// Latency is only meaningful with the plugin on the same machine.
+
+#include <atomic>
+#include <chrono>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include <util/threading.h>
+#include "../src/latency.h"
+#include "../src/structs.h"
+#include "../src/transport.h"
+
+using steady = std::chrono::steady_clock;
+
+// sys-*.cc log through libobs
+extern "C" void blog(int log_level, const char *format, ...) {
+    (void) log_level;
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+struct options {
+    int instance = 0;
+    int width = DEF_WIDTH, height = DEF_HEIGHT;
+    int fps = 30;
+    int read_fps = 0;
+    int format = FOURCC_YUY2;
+    int slots = VIDEO_FRAME_SLOTS;
+    int sample_rate = 48000;
+    int channels = 2;
+    int chunk_frames = 0;
+    int sample_format = SAMPLE_FMT_S16;
+    int seconds = 10;
+    bool video = true;
+    bool audio = true;
+};
+
+// Counters are reset by the reporter every second, the histograms
+// are kept for the summary
+struct stats {
+    std::atomic<long> frames{0};
+    std::atomic<long> duplicates{0};
+    std::atomic<long> torn{0};
+    std::atomic<long> empty{0};     // no frame yet / single buffer timeout
+    std::atomic<long> chunks{0};
+    std::atomic<long> underruns{0};
+    std::atomic<long long> video_lat_ns{0}, audio_lat_ns{0};
+    LatencyHistogram video_hist, audio_hist;
+};
+
+static std::atomic<bool> running{true};
+
+// Stop like -t ran out: readers and the report loop see it within a
+// second, the summary is printed and the shared memory released
+static void on_signal(int sig) {
+    (void) sig;
+    running = false;
+}
+
+static uint64_t now_ns(void) {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        steady::now().time_since_epoch()).count();
+}
+
+static const char *instance_name(char *buf, size_t size, const char *name, int instance) {
+    if (instance == 0)
+        return name;
+
+    snprintf(buf, size, "%s_%d", name, instance);
+    return buf;
+}
+
+static size_t frame_bytes(const options &o) {
+    const size_t pixels = (size_t) o.width * o.height;
+    return o.format == (int) FOURCC_NV12 || o.format == (int) FOURCC_I420
+        ? pixels * 3 / 2 : pixels * 2;
+}
+
+static void video_reader(const options &o, VideoHeader *header, uint8_t *data,
+    SharedEvent *wr, SharedEvent *rd, stats *st)
+{
+    VideoFrameRing *ring = &header->ring;
+    const size_t size = frame_bytes(o);
+    std::vector<uint8_t> frame(size);
+    const auto tick = std::chrono::nanoseconds(1000000000LL / (o.read_fps ? o.read_fps : o.fps));
+    auto next = steady::now();
+    long last_seq = -1;
+    long long last_pts = -1;
+
+    while (running.load()) {
+        next += tick;
+        std::this_thread::sleep_until(next);
+
+        long long pts = -1;
+        if (o.slots == VIDEO_FRAME_SLOTS) {
+            // a map we created ourselves is all zeroes until the plugin starts
+            long slot = os_atomic_load_long(&ring->latest);
+            if (slot < 0 || os_atomic_load_long(&ring->seq) == 0) {
+                st->empty++;
+                continue;
+            }
+
+            for (;;) {
+                os_atomic_set_long(&ring->reading, slot);
+                const long q = os_atomic_load_long(&ring->slot_seq[slot]);
+                if ((q & 1) == 0) {
+                    memcpy(frame.data(), data + (size_t) slot * VIDEO_SLOT_SIZE, size);
+                    pts = ring->slot_pts[slot];
+                    if (os_atomic_load_long(&ring->slot_seq[slot]) == q)
+                        break;
+                }
+
+                // the plugin wrote the slot before it saw `reading`
+                st->torn++;
+                slot = os_atomic_load_long(&ring->latest);
+            }
+            os_atomic_set_long(&ring->reading, -1);
+
+            const long seq = os_atomic_load_long(&ring->seq);
+            if (seq == last_seq)
+                st->duplicates++;
+            last_seq = seq;
+        } else {
+            ResetSharedEvent(rd);
+            if (!WaitSharedEvent(wr, 100)) {
+                SetSharedEvent(rd);
+                st->empty++;
+                continue;
+            }
+
+            memcpy(frame.data(), data, size);
+            pts = ring->slot_pts[0];
+            SetSharedEvent(rd);
+
+            if (pts == last_pts)
+                st->duplicates++;
+            last_pts = pts;
+        }
+
+        st->frames++;
+        if (pts > 0) {
+            const uint64_t now = now_ns();
+            st->video_lat_ns += (long long) now - pts;
+            st->video_hist.record((uint64_t) pts, now);
+        }
+    }
+}
+
+static void audio_reader(const options &o, AudioHeader *header, uint8_t *data,
+    SharedEvent *rd, stats *st)
+{
+    std::vector<uint8_t> chunk(AUDIO_CHUNK_BYTES);
+    const int chunk_frames = o.chunk_frames ? o.chunk_frames : DEF_FRAMES;
+    const auto tick = std::chrono::nanoseconds(1000000000LL * chunk_frames / o.sample_rate);
+    auto next = steady::now();
+
+    while (running.load()) {
+        next += tick;
+        std::this_thread::sleep_until(next);
+
+        if (!((volatile AudioHeader *) header)->data_valid) {
+            st->underruns++;
+            continue;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        const int frames = header->frames;
+        const long long pts = header->pts;
+        const int bytes = frames * o.channels * (o.sample_format == SAMPLE_FMT_S24 ? 3
+            : o.sample_format == SAMPLE_FMT_F32 ? 4 : 2);
+        if (bytes > 0 && bytes <= AUDIO_CHUNK_BYTES)
+            memcpy(chunk.data(), data, bytes);
+
+        std::atomic_thread_fence(std::memory_order_release);
+        ((volatile AudioHeader *) header)->data_valid = 0;
+        SetSharedEvent(rd);
+
+        st->chunks++;
+        if (pts > 0) {
+            const uint64_t now = now_ns();
+            st->audio_lat_ns += (long long) now - pts;
+            st->audio_hist.record((uint64_t) pts, now);
+        }
+    }
+}
+
+static void print_percentiles(const char *what, const LatencyHistogram &h) {
+    const uint64_t count = h.count.load();
+    if (!count) {
+        printf("%s latency: no samples\n", what);
+        return;
+    }
+
+    auto pct = [&h, count](int p) {
+        const uint64_t rank = (count - 1) * p / 100;
+        uint64_t seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            seen += h.buckets[i].load(std::memory_order_relaxed);
+            if (seen > rank)
+                return LatencyHistogram::bucket_max(i) / 1e3;
+        }
+        return h.peak.load() / 1e3;
+    };
+    printf("%s latency ms: min %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f (%llu samples)\n",
+        what, pct(0), pct(50), pct(90), pct(99), h.peak.load() / 1e3,
+        (unsigned long long) count);
+}
+
+static int parse_format(const char *s) {
+    if (!strcmp(s, "yuy2")) return FOURCC_YUY2;
+    if (!strcmp(s, "uyvy")) return FOURCC_UYVY;
+    if (!strcmp(s, "nv12")) return FOURCC_NV12;
+    if (!strcmp(s, "i420")) return FOURCC_I420;
+    return -1;
+}
+
+static int parse_sample_format(const char *s) {
+    if (!strcmp(s, "s16")) return SAMPLE_FMT_S16;
+    if (!strcmp(s, "s24")) return SAMPLE_FMT_S24;
+    if (!strcmp(s, "f32")) return SAMPLE_FMT_F32;
+    return -1;
+}
+
+static bool parse_args(int argc, char **argv, options *o) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "-V")) { o->video = false; continue; }
+        if (!strcmp(a, "-A")) { o->audio = false; continue; }
+        if (!v || a[0] != '-' || strlen(a) != 2)
+            return false;
+
+        i++;
+        switch (a[1]) {
+        case 'i': o->instance = atoi(v); break;
+        case 's': if (sscanf(v, "%dx%d", &o->width, &o->height) != 2) return false; break;
+        case 'r': o->fps = atoi(v); break;
+        case 'c': o->read_fps = atoi(v); break;
+        case 'f': o->format = parse_format(v); break;
+        case 'b': o->slots = atoi(v); break;
+        case 'a': o->sample_rate = atoi(v); break;
+        case 'n': o->channels = atoi(v); break;
+        case 'k': o->chunk_frames = atoi(v); break;
+        case 'p': o->sample_format = parse_sample_format(v); break;
+        case 't': o->seconds = atoi(v); break;
+        default: return false;
+        }
+    }
+
+    return o->instance >= 0 && o->instance < MAX_INSTANCES
+        && o->width > 0 && o->width <= MAX_WIDTH && o->height > 0 && o->height <= MAX_HEIGHT
+        && o->fps > 0 && o->read_fps >= 0 && o->format != -1
+        && (o->slots == 1 || o->slots == VIDEO_FRAME_SLOTS)
+        && o->sample_rate > 0 && o->channels > 0 && o->channels <= MAX_CHANNELZ
+        && o->chunk_frames >= 0 && o->sample_format != -1 && o->seconds >= 0;
+}
+
+int main(int argc, char **argv) {
+    options o;
+    if (!parse_args(argc, argv, &o)) {
+        fprintf(stderr, "bad arguments, see the top of tools/consumer.cc\n");
+        return 1;
+    }
+
+    char buf[64];
+    SharedMem video_mem = {}, audio_mem = {};
+    SharedEvent wr = {}, rd = {}, audio_rd = {}, control = {};
+    const int n = o.instance;
+    if (!CreateSharedEvent(&control, instance_name(buf, sizeof(buf), CONTROL_EVENT_NAME, n), false, false))
+        return 1;
+
+    VideoHeader *vh = NULL;
+    if (o.video) {
+        if (!CreateSharedMem(&video_mem, instance_name(buf, sizeof(buf), VIDEO_MAP_NAME, n), VIDEO_MAP_SIZE)
+            || !CreateSharedEvent(&wr, instance_name(buf, sizeof(buf), VIDEO_WR_LOCK_NAME, n), true, true)
+            || !CreateSharedEvent(&rd, instance_name(buf, sizeof(buf), VIDEO_RD_LOCK_NAME, n), true, true))
+            return 1;
+
+        vh = (VideoHeader *) video_mem.mem;
+        vh->info.version = 1;
+        vh->info.width = o.width;
+        vh->info.height = o.height;
+        vh->info.interval = (int) (RefTime::UNITS / o.fps);
+        vh->info.format = o.format;
+        vh->info.checksum = vh->info.interval ^ vh->info.width ^ vh->info.height;
+        os_atomic_set_long(&vh->ring.reading, -1);
+        os_atomic_set_long(&vh->ring.frame_slots, o.slots == VIDEO_FRAME_SLOTS ? VIDEO_FRAME_SLOTS : 0);
+        vh->info.control = CONTROL;
+    }
+
+    AudioHeader *ah = NULL;
+    if (o.audio) {
+        if (!CreateSharedMem(&audio_mem, instance_name(buf, sizeof(buf), AUDIO_MAP_NAME, n), AUDIO_MAP_SIZE)
+            || !CreateSharedEvent(&audio_rd, instance_name(buf, sizeof(buf), AUDIO_RD_EVENT_NAME, n), false, false))
+            return 1;
+
+        ah = (AudioHeader *) audio_mem.mem;
+        ah->info.version = 1;
+        ah->info.sample_rate = o.sample_rate;
+        ah->info.channels = o.channels;
+        ah->info.checksum = o.sample_rate ^ o.channels;
+        ah->chunk_frames = o.chunk_frames;
+        ah->sample_format = o.sample_format;
+        ah->data_event = 1;
+        ah->data_valid = 0;
+        ah->info.control = CONTROL;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    SetSharedEvent(&control);
+    printf("instance %d: video %s, audio %s\n", n,
+        o.video ? "on" : "off", o.audio ? "on" : "off");
+
+    stats st;
+    std::thread video_thread, audio_thread;
+    if (o.video)
+        video_thread = std::thread(video_reader, std::cref(o), vh,
+            video_mem.mem + sizeof(VideoHeader), &wr, &rd, &st);
+    if (o.audio)
+        audio_thread = std::thread(audio_reader, std::cref(o), ah,
+            audio_mem.mem + sizeof(AudioHeader), &audio_rd, &st);
+
+    long total[6] = {};
+    for (int s = 1; running.load() && (o.seconds == 0 || s <= o.seconds); s++) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        const long frames = st.frames.exchange(0), dup = st.duplicates.exchange(0);
+        const long torn = st.torn.exchange(0), empty = st.empty.exchange(0);
+        const long chunks = st.chunks.exchange(0), under = st.underruns.exchange(0);
+        const long long vlat = st.video_lat_ns.exchange(0), alat = st.audio_lat_ns.exchange(0);
+        printf("%3ds video %ld fps, %ld dup, %ld torn, %ld empty, lat %.2f ms"
+            " | audio %ld chunks, %ld underruns, lat %.2f ms\n", s,
+            frames, dup, torn, empty, frames ? vlat / 1e6 / frames : 0.0,
+            chunks, under, chunks ? alat / 1e6 / chunks : 0.0);
+        fflush(stdout);
+
+        total[0] += frames; total[1] += dup; total[2] += torn;
+        total[3] += empty;  total[4] += chunks; total[5] += under;
+    }
+
+    running = false;
+    if (video_thread.joinable()) video_thread.join();
+    if (audio_thread.joinable()) audio_thread.join();
+
+    printf("total: %ld frames, %ld dup, %ld torn, %ld empty, %ld audio chunks, %ld underruns\n",
+        total[0], total[1], total[2], total[3], total[4], total[5]);
+    print_percentiles("video", st.video_hist);
+    print_percentiles("audio", st.audio_hist);
+
+    // let the plugin go back to its defaults
+    if (vh) vh->info.control = 0;
+    if (ah) ah->info.control = 0;
+    SetSharedEvent(&control);
+
+    if (o.video) {
+        CloseSharedEvent(&wr);
+        CloseSharedEvent(&rd);
+        CloseSharedMem(&video_mem);
+    }
+    if (o.audio) {
+        CloseSharedEvent(&audio_rd);
+        CloseSharedMem(&audio_mem);
+    }
+    CloseSharedEvent(&control);
+    return 0;
+}
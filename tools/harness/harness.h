@@ -0,0 +1,53 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdint.h>
+#include <obs-module.h>
+
+// Headless stand-in for libobs (obs-harness.cc), enough to load the
+// plugin with DROIDCAM_OVERRIDE=1 and run its outputs without OBS Studio.
+//
+// Once an output begins data capture, one thread feeds it video frames
+// and another feeds it audio packets, synthetic, in whatever conversion
+// the output asked for. Timestamps are os_gettime_ns() at the time each
+// frame is due, like the OBS render and audio threads. Ending capture
+// stops both threads, then emits "deactivate" from another thread.
+//
+// POSIX only: the plugin itself relies on pthreads, which OBS supplies
+// on windows.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HARNESS_VIDEO 0
+#define HARNESS_AUDIO 1
+
+// Frames per audio packet, what libobs uses
+#define HARNESS_AUDIO_FRAMES 1024
+
+struct harness_config {
+    // the canvas, what obs_get_video() reports
+    uint32_t width, height;
+    enum video_format format;   // VIDEO_FORMAT_NV12 or VIDEO_FORMAT_I420
+    uint32_t fps_num, fps_den;
+    bool free_run;              // video back to back, timestamps still fps apart
+
+    // what obs_get_audio() reports
+    uint32_t sample_rate;
+    int channels;
+
+    int log_level;              // blog() prints up to this level
+
+    // Called on the feeding thread after each raw_video / raw_audio
+    void (*callback_done)(void *param, int kind, uint64_t start_ns, uint64_t end_ns);
+    // Called when an output starts or stops capturing
+    void (*capture_changed)(void *param, bool active, uint64_t ns);
+    void *param;
+};
+
+// Before obs_module_load()
+void harness_init(const struct harness_config *config);
+
+#ifdef __cplusplus
+} // "C"
+#endif
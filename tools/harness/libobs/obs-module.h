@@ -0,0 +1,185 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+
+// Stand-in for the part of libobs the plugin uses, see tools/harness.
+// Names and signatures follow libobs, only what src/ needs is declared.
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    LOG_ERROR   = 100,
+    LOG_WARNING = 200,
+    LOG_INFO    = 300,
+    LOG_DEBUG   = 400,
+};
+
+void blog(int log_level, const char *format, ...);
+
+void *bmalloc(size_t size);
+void bfree(void *ptr);
+
+#define UNUSED_PARAMETER(param) (void) param
+
+#define MODULE_EXPORT
+#define OBS_DECLARE_MODULE()
+#define OBS_MODULE_USE_DEFAULT_LOCALE(module_name, default_locale) \
+    const char *obs_module_text(const char *val) { return val; }
+
+const char *obs_module_text(const char *lookup_string);
+
+#define MAX_AV_PLANES 8
+
+enum video_format {
+    VIDEO_FORMAT_NONE,
+    VIDEO_FORMAT_I420,
+    VIDEO_FORMAT_NV12,
+    VIDEO_FORMAT_YVYU,
+    VIDEO_FORMAT_YUY2,
+    VIDEO_FORMAT_UYVY,
+};
+
+enum video_colorspace { VIDEO_CS_DEFAULT };
+enum video_range_type { VIDEO_RANGE_DEFAULT };
+
+enum audio_format {
+    AUDIO_FORMAT_UNKNOWN,
+    AUDIO_FORMAT_U8BIT,
+    AUDIO_FORMAT_16BIT,
+    AUDIO_FORMAT_32BIT,
+    AUDIO_FORMAT_FLOAT,
+    AUDIO_FORMAT_U8BIT_PLANAR,
+    AUDIO_FORMAT_16BIT_PLANAR,
+    AUDIO_FORMAT_32BIT_PLANAR,
+    AUDIO_FORMAT_FLOAT_PLANAR,
+};
+
+enum speaker_layout {
+    SPEAKERS_UNKNOWN,
+    SPEAKERS_MONO,
+    SPEAKERS_STEREO,
+    SPEAKERS_2POINT1,
+    SPEAKERS_4POINT0,
+    SPEAKERS_4POINT1,
+    SPEAKERS_5POINT1,
+    SPEAKERS_7POINT1 = 8,
+};
+
+struct video_data {
+    uint8_t *data[MAX_AV_PLANES];
+    uint32_t linesize[MAX_AV_PLANES];
+    uint64_t timestamp;
+};
+
+struct audio_data {
+    uint8_t *data[MAX_AV_PLANES];
+    uint32_t frames;
+    uint64_t timestamp;
+};
+
+struct video_scale_info {
+    enum video_format format;
+    uint32_t width;
+    uint32_t height;
+    enum video_range_type range;
+    enum video_colorspace colorspace;
+};
+
+struct audio_convert_info {
+    uint32_t samples_per_sec;
+    enum audio_format format;
+    enum speaker_layout speakers;
+    bool allow_clipping;
+};
+
+struct obs_video_info {
+    const char *graphics_module;
+    uint32_t fps_num;
+    uint32_t fps_den;
+    uint32_t base_width;
+    uint32_t base_height;
+    uint32_t output_width;
+    uint32_t output_height;
+    enum video_format output_format;
+};
+
+typedef struct obs_output obs_output_t;
+typedef struct obs_data obs_data_t;
+typedef struct video_output video_t;
+typedef struct audio_output audio_t;
+typedef struct signal_handler signal_handler_t;
+typedef struct calldata calldata_t;
+typedef void (*signal_callback_t)(void *data, calldata_t *cd);
+
+#define OBS_OUTPUT_VIDEO (1 << 0)
+#define OBS_OUTPUT_AUDIO (1 << 1)
+#define OBS_OUTPUT_AV    (OBS_OUTPUT_VIDEO | OBS_OUTPUT_AUDIO)
+
+struct obs_output_info {
+    const char *id;
+    uint32_t flags;
+    const char *(*get_name)(void *type_data);
+    void *(*create)(obs_data_t *settings, obs_output_t *output);
+    void (*destroy)(void *data);
+    bool (*start)(void *data);
+    void (*stop)(void *data, uint64_t ts);
+    void (*raw_video)(void *data, struct video_data *frame);
+    void (*raw_audio)(void *data, struct audio_data *frames);
+    void (*get_defaults)(obs_data_t *settings);
+};
+
+void obs_register_output(struct obs_output_info *info);
+
+obs_output_t *obs_output_create(const char *id, const char *name,
+    obs_data_t *settings, obs_data_t *hotkey_data);
+void obs_output_release(obs_output_t *output);
+void obs_output_set_media(obs_output_t *output, video_t *video, audio_t *audio);
+bool obs_output_start(obs_output_t *output);
+void obs_output_force_stop(obs_output_t *output);
+bool obs_output_active(const obs_output_t *output);
+bool obs_output_begin_data_capture(obs_output_t *output, uint32_t flags);
+void obs_output_end_data_capture(obs_output_t *output);
+void obs_output_set_video_conversion(obs_output_t *output,
+    const struct video_scale_info *conversion);
+void obs_output_set_audio_conversion(obs_output_t *output,
+    const struct audio_convert_info *conversion);
+video_t *obs_output_video(const obs_output_t *output);
+audio_t *obs_output_audio(const obs_output_t *output);
+signal_handler_t *obs_output_get_signal_handler(const obs_output_t *output);
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal,
+    signal_callback_t callback, void *data);
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
+    signal_callback_t callback, void *data);
+
+video_t *obs_get_video(void);
+audio_t *obs_get_audio(void);
+bool obs_get_video_info(struct obs_video_info *ovi);
+
+uint32_t video_output_get_width(const video_t *video);
+uint32_t video_output_get_height(const video_t *video);
+enum video_format video_output_get_format(const video_t *video);
+size_t audio_output_get_channels(const audio_t *audio);
+uint32_t audio_output_get_sample_rate(const audio_t *audio);
+
+obs_data_t *obs_data_create(void);
+void obs_data_release(obs_data_t *data);
+void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+long long obs_data_get_int(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+void obs_apply_private_data(obs_data_t *settings);
+
+#ifdef __cplusplus
+} // "C"
+#endif
@@ -0,0 +1,6 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdbool.h>
+
+// Only used by the Tools menu, which is left out with DROIDCAM_OVERRIDE
+typedef struct config_data config_t;
@@ -0,0 +1,17 @@
+// Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Monotonic, same clock as std::chrono::steady_clock
+uint64_t os_gettime_ns(void);
+void os_sleep_ms(uint32_t duration);
+int os_get_logical_cores(void);
+
+#ifdef __cplusplus
+} // "C"
+#endif
@@ -0,0 +1,691 @@
+/*
+Copyright (C) 2025 DEV47APPS, github.com/dev47apps
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "harness.h"
+
+#define VIDEO_PATTERN_FRAMES 4
+
+// Line sizes are 32-byte aligned, as OBS hands them over
+#define LINESIZE(bytes) (((bytes) + 31) & ~31u)
+
+static harness_config config;
+static std::vector<obs_output_info> registered;
+
+struct video_output {
+    uint32_t width, height;
+    enum video_format format;
+};
+
+struct audio_output {
+    uint32_t sample_rate;
+    int channels;
+};
+
+static video_output canvas_video;
+static audio_output canvas_audio;
+
+struct obs_data {
+    std::map<std::string, long long> values;
+    std::map<std::string, long long> defaults;
+};
+
+struct signal_slot {
+    std::string signal;
+    signal_callback_t callback;
+    void *data;
+};
+
+struct signal_handler {
+    std::mutex lock;
+    std::vector<signal_slot> slots;
+};
+
+struct obs_output {
+    obs_output_info info;
+    void *data;
+    video_t *video;
+    audio_t *audio;
+    signal_handler signals;
+
+    // capture state, see begin/end_data_capture
+    std::mutex lock;
+    std::atomic<bool> active;
+    std::atomic<bool> feeding;
+    bool ending;
+    bool started;
+    std::thread video_thread, audio_thread, end_thread;
+
+    video_scale_info video_conv;
+    audio_convert_info audio_conv;
+    bool have_video_conv, have_audio_conv;
+};
+
+void harness_init(const harness_config *c) {
+    config = *c;
+    canvas_video.width  = config.width;
+    canvas_video.height = config.height;
+    canvas_video.format = config.format;
+    canvas_audio.sample_rate = config.sample_rate;
+    canvas_audio.channels = config.channels;
+}
+
+// -- util
+
+uint64_t os_gettime_ns(void) {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void os_sleep_ms(uint32_t duration) {
+    if (duration)
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+    else
+        std::this_thread::yield();
+}
+
+static void sleep_until_ns(uint64_t ns) {
+    const uint64_t now = os_gettime_ns();
+    if (ns > now)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(ns - now));
+}
+
+int os_get_logical_cores(void) {
+    return (int) std::thread::hardware_concurrency();
+}
+
+void os_set_thread_name(const char *name) {
+    #ifdef __linux__
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%s", name);
+    pthread_setname_np(pthread_self(), buf);
+    #else
+    UNUSED_PARAMETER(name);
+    #endif
+}
+
+void blog(int log_level, const char *format, ...) {
+    if (log_level > config.log_level)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// libobs aligns its allocations, the conversion code may rely on it
+void *bmalloc(size_t size) {
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, 32, size ? size : 1) != 0)
+        return NULL;
+    return ptr;
+}
+
+void bfree(void *ptr) {
+    free(ptr);
+}
+
+struct os_event_data {
+    std::mutex lock;
+    std::condition_variable cond;
+    bool signalled;
+    bool manual;
+};
+
+int os_event_init(os_event_t **event, enum os_event_type type) {
+    os_event_t *ev = new os_event_t;
+    ev->signalled = false;
+    ev->manual = type == OS_EVENT_TYPE_MANUAL;
+    *event = ev;
+    return 0;
+}
+
+void os_event_destroy(os_event_t *event) {
+    delete event;
+}
+
+int os_event_wait(os_event_t *event) {
+    std::unique_lock<std::mutex> guard(event->lock);
+    event->cond.wait(guard, [event] { return event->signalled; });
+    if (!event->manual)
+        event->signalled = false;
+    return 0;
+}
+
+int os_event_timedwait(os_event_t *event, unsigned long milliseconds) {
+    std::unique_lock<std::mutex> guard(event->lock);
+    if (!event->cond.wait_for(guard, std::chrono::milliseconds(milliseconds),
+            [event] { return event->signalled; }))
+        return ETIMEDOUT;
+
+    if (!event->manual)
+        event->signalled = false;
+    return 0;
+}
+
+int os_event_try(os_event_t *event) {
+    std::lock_guard<std::mutex> guard(event->lock);
+    if (!event->signalled)
+        return EAGAIN;
+
+    if (!event->manual)
+        event->signalled = false;
+    return 0;
+}
+
+int os_event_signal(os_event_t *event) {
+    std::lock_guard<std::mutex> guard(event->lock);
+    event->signalled = true;
+    if (event->manual)
+        event->cond.notify_all();
+    else
+        event->cond.notify_one();
+    return 0;
+}
+
+void os_event_reset(os_event_t *event) {
+    std::lock_guard<std::mutex> guard(event->lock);
+    event->signalled = false;
+}
+
+struct os_sem_data {
+    std::mutex lock;
+    std::condition_variable cond;
+    int count;
+};
+
+int os_sem_init(os_sem_t **sem, int value) {
+    os_sem_t *s = new os_sem_t;
+    s->count = value;
+    *sem = s;
+    return 0;
+}
+
+void os_sem_destroy(os_sem_t *sem) {
+    delete sem;
+}
+
+int os_sem_post(os_sem_t *sem) {
+    std::lock_guard<std::mutex> guard(sem->lock);
+    sem->count++;
+    sem->cond.notify_one();
+    return 0;
+}
+
+int os_sem_wait(os_sem_t *sem) {
+    std::unique_lock<std::mutex> guard(sem->lock);
+    sem->cond.wait(guard, [sem] { return sem->count > 0; });
+    sem->count--;
+    return 0;
+}
+
+// -- obs_data
+
+obs_data_t *obs_data_create(void) {
+    return new obs_data_t;
+}
+
+void obs_data_release(obs_data_t *data) {
+    delete data;
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val) {
+    data->values[name] = val;
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val) {
+    data->values[name] = val;
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val) {
+    data->defaults[name] = val;
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val) {
+    data->defaults[name] = val;
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name) {
+    auto it = data->values.find(name);
+    if (it != data->values.end())
+        return it->second;
+
+    it = data->defaults.find(name);
+    return it != data->defaults.end() ? it->second : 0;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name) {
+    return obs_data_get_int(data, name) != 0;
+}
+
+void obs_apply_private_data(obs_data_t *settings) {
+    UNUSED_PARAMETER(settings);
+}
+
+// -- canvas
+
+video_t *obs_get_video(void) {
+    return &canvas_video;
+}
+
+audio_t *obs_get_audio(void) {
+    return &canvas_audio;
+}
+
+bool obs_get_video_info(struct obs_video_info *ovi) {
+    memset(ovi, 0, sizeof(*ovi));
+    ovi->graphics_module = "harness";
+    ovi->fps_num = config.fps_num;
+    ovi->fps_den = config.fps_den;
+    ovi->base_width = ovi->output_width = canvas_video.width;
+    ovi->base_height = ovi->output_height = canvas_video.height;
+    ovi->output_format = canvas_video.format;
+    return true;
+}
+
+uint32_t video_output_get_width(const video_t *video) {
+    return video->width;
+}
+
+uint32_t video_output_get_height(const video_t *video) {
+    return video->height;
+}
+
+enum video_format video_output_get_format(const video_t *video) {
+    return video->format;
+}
+
+size_t audio_output_get_channels(const audio_t *audio) {
+    return (size_t) audio->channels;
+}
+
+uint32_t audio_output_get_sample_rate(const audio_t *audio) {
+    return audio->sample_rate;
+}
+
+// -- signals
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal,
+    signal_callback_t callback, void *data)
+{
+    std::lock_guard<std::mutex> guard(handler->lock);
+    handler->slots.push_back({ signal, callback, data });
+}
+
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
+    signal_callback_t callback, void *data)
+{
+    std::lock_guard<std::mutex> guard(handler->lock);
+    for (auto it = handler->slots.begin(); it != handler->slots.end(); ++it) {
+        if (it->signal == signal && it->callback == callback && it->data == data) {
+            handler->slots.erase(it);
+            return;
+        }
+    }
+}
+
+static void signal_emit(signal_handler_t *handler, const char *signal) {
+    std::vector<signal_slot> slots;
+    {
+        std::lock_guard<std::mutex> guard(handler->lock);
+        slots = handler->slots;
+    }
+
+    for (const signal_slot &slot : slots)
+        if (slot.signal == signal)
+            slot.callback(slot.data, NULL);
+}
+
+// -- synthetic media
+
+static int speaker_channels(enum speaker_layout speakers) {
+    switch (speakers) {
+    case SPEAKERS_MONO:    return 1;
+    case SPEAKERS_STEREO:  return 2;
+    case SPEAKERS_2POINT1: return 3;
+    case SPEAKERS_4POINT0: return 4;
+    case SPEAKERS_4POINT1: return 5;
+    case SPEAKERS_5POINT1: return 6;
+    case SPEAKERS_7POINT1: return 8;
+    default:               return 0;
+    }
+}
+
+struct pattern_frame {
+    std::vector<uint8_t> planes[3];
+    uint32_t linesize[3];
+};
+
+// Luma ramp with a bright bar that moves from frame to frame
+static void pattern_fill(pattern_frame *f, enum video_format format,
+    uint32_t width, uint32_t height, int index)
+{
+    const uint32_t bar = (uint32_t) index * width / VIDEO_PATTERN_FRAMES;
+    const uint32_t bar_w = width / (VIDEO_PATTERN_FRAMES * 2);
+    auto luma = [=](uint32_t x, uint32_t y) -> uint8_t {
+        return (x >= bar && x < bar + bar_w) ? 235 : (uint8_t) (16 + (x + y) * 200 / (width + height));
+    };
+
+    switch (format) {
+    case VIDEO_FORMAT_YUY2:
+    case VIDEO_FORMAT_UYVY: {
+        const int y_off = format == VIDEO_FORMAT_YUY2 ? 0 : 1;
+        f->linesize[0] = LINESIZE(width * 2);
+        f->planes[0].resize((size_t) f->linesize[0] * height);
+        for (uint32_t y = 0; y < height; y++) {
+            uint8_t *row = f->planes[0].data() + (size_t) y * f->linesize[0];
+            for (uint32_t x = 0; x < width; x++) {
+                row[x * 2 + y_off] = luma(x, y);
+                row[x * 2 + (y_off ^ 1)] = (uint8_t) ((x & 1) ? 128 - y * 32 / height : 128 + x * 32 / width);
+            }
+        }
+        break;
+    }
+    default: {
+        const bool nv12 = format == VIDEO_FORMAT_NV12;
+        f->linesize[0] = LINESIZE(width);
+        f->linesize[1] = nv12 ? LINESIZE(width) : LINESIZE(width / 2);
+        f->linesize[2] = nv12 ? 0 : f->linesize[1];
+        f->planes[0].resize((size_t) f->linesize[0] * height);
+        for (int p = 1; p < (nv12 ? 2 : 3); p++)
+            f->planes[p].resize((size_t) f->linesize[p] * (height / 2));
+
+        for (uint32_t y = 0; y < height; y++)
+            for (uint32_t x = 0; x < width; x++)
+                f->planes[0][(size_t) y * f->linesize[0] + x] = luma(x, y);
+
+        for (uint32_t y = 0; y < height / 2; y++) {
+            for (uint32_t x = 0; x < width / 2; x++) {
+                const uint8_t u = (uint8_t) (128 + x * 64 / width);
+                const uint8_t v = (uint8_t) (128 - y * 64 / height);
+                const size_t row = (size_t) y * f->linesize[1];
+                if (nv12) {
+                    f->planes[1][row + x * 2] = u;
+                    f->planes[1][row + x * 2 + 1] = v;
+                } else {
+                    f->planes[1][row + x] = u;
+                    f->planes[2][row + x] = v;
+                }
+            }
+        }
+        break;
+    }
+    }
+}
+
+static void feed_video(obs_output_t *output) {
+    os_set_thread_name("harness-video");
+    video_scale_info conv = {};
+    conv.format = canvas_video.format;
+    conv.width  = canvas_video.width;
+    conv.height = canvas_video.height;
+    if (output->have_video_conv)
+        conv = output->video_conv;
+
+    pattern_frame frames[VIDEO_PATTERN_FRAMES];
+    for (int i = 0; i < VIDEO_PATTERN_FRAMES; i++)
+        pattern_fill(&frames[i], conv.format, conv.width, conv.height, i);
+
+    const uint64_t interval = (uint64_t) 1000000000 * config.fps_den / config.fps_num;
+    uint64_t due = os_gettime_ns();
+    for (unsigned n = 0; output->feeding.load(std::memory_order_acquire); n++) {
+        if (!config.free_run)
+            sleep_until_ns(due);
+
+        pattern_frame *f = &frames[n % VIDEO_PATTERN_FRAMES];
+        struct video_data frame = {};
+        for (int p = 0; p < 3; p++) {
+            frame.data[p] = f->planes[p].empty() ? NULL : f->planes[p].data();
+            frame.linesize[p] = f->linesize[p];
+        }
+
+        const uint64_t start = os_gettime_ns();
+        frame.timestamp = due;
+        output->info.raw_video(output->data, &frame);
+        const uint64_t end = os_gettime_ns();
+        if (config.callback_done)
+            config.callback_done(config.param, HARNESS_VIDEO, start, end);
+
+        // Like the render thread, frames that are already late are skipped.
+        // Free running, timestamps keep the nominal spacing so that every
+        // frame counts as a new one to the plugin.
+        due += interval;
+        while (!config.free_run && due + interval <= end)
+            due += interval;
+    }
+}
+
+static void feed_audio(obs_output_t *output) {
+    os_set_thread_name("harness-audio");
+    uint32_t rate = canvas_audio.sample_rate;
+    int channels = canvas_audio.channels;
+    if (output->have_audio_conv) {
+        rate = output->audio_conv.samples_per_sec;
+        channels = speaker_channels(output->audio_conv.speakers);
+    }
+    if (channels <= 0 || channels > MAX_AV_PLANES || rate == 0)
+        return;
+
+    std::vector<float> planes[MAX_AV_PLANES];
+    for (int c = 0; c < channels; c++)
+        planes[c].resize(HARNESS_AUDIO_FRAMES);
+
+    const uint64_t start_ns = os_gettime_ns();
+    uint64_t sent = 0;
+    while (output->feeding.load(std::memory_order_acquire)) {
+        const uint64_t due = start_ns + sent * 1000000000 / rate;
+        sleep_until_ns(due);
+
+        // a tone per channel, 440 Hz and up
+        for (int c = 0; c < channels; c++)
+            for (int i = 0; i < HARNESS_AUDIO_FRAMES; i++)
+                planes[c][i] = 0.25f * sinf((float) ((sent + i) % rate) * (440.0f + 110.0f * c)
+                    * 6.2831853f / (float) rate);
+
+        struct audio_data packet = {};
+        for (int c = 0; c < channels; c++)
+            packet.data[c] = (uint8_t *) planes[c].data();
+        packet.frames = HARNESS_AUDIO_FRAMES;
+        packet.timestamp = due;
+
+        const uint64_t start = os_gettime_ns();
+        output->info.raw_audio(output->data, &packet);
+        const uint64_t end = os_gettime_ns();
+        if (config.callback_done)
+            config.callback_done(config.param, HARNESS_AUDIO, start, end);
+
+        sent += HARNESS_AUDIO_FRAMES;
+    }
+}
+
+// -- outputs
+
+void obs_register_output(struct obs_output_info *info) {
+    registered.push_back(*info);
+}
+
+obs_output_t *obs_output_create(const char *id, const char *name,
+    obs_data_t *settings, obs_data_t *hotkey_data)
+{
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(hotkey_data);
+    const obs_output_info *info = NULL;
+    for (const obs_output_info &i : registered)
+        if (!strcmp(i.id, id))
+            info = &i;
+    if (!info) {
+        blog(LOG_WARNING, "harness: output type %s not registered", id);
+        return NULL;
+    }
+
+    obs_output_t *output = new obs_output_t;
+    output->info = *info;
+    output->data = NULL;
+    output->video = &canvas_video;
+    output->audio = &canvas_audio;
+    output->active = false;
+    output->feeding = false;
+    output->ending = false;
+    output->started = false;
+    output->have_video_conv = false;
+    output->have_audio_conv = false;
+
+    obs_data_t *defaults = settings ? NULL : obs_data_create();
+    if (output->info.get_defaults)
+        output->info.get_defaults(settings ? settings : defaults);
+
+    output->data = output->info.create(settings ? settings : defaults, output);
+    obs_data_release(defaults);
+    if (!output->data) {
+        delete output;
+        return NULL;
+    }
+    return output;
+}
+
+void obs_output_set_media(obs_output_t *output, video_t *video, audio_t *audio) {
+    output->video = video;
+    output->audio = audio;
+}
+
+video_t *obs_output_video(const obs_output_t *output) {
+    return output->video;
+}
+
+audio_t *obs_output_audio(const obs_output_t *output) {
+    return output->audio;
+}
+
+signal_handler_t *obs_output_get_signal_handler(const obs_output_t *output) {
+    return const_cast<signal_handler_t *>(&output->signals);
+}
+
+void obs_output_set_video_conversion(obs_output_t *output,
+    const struct video_scale_info *conversion)
+{
+    output->video_conv = *conversion;
+    output->have_video_conv = true;
+}
+
+void obs_output_set_audio_conversion(obs_output_t *output,
+    const struct audio_convert_info *conversion)
+{
+    output->audio_conv = *conversion;
+    output->have_audio_conv = true;
+}
+
+bool obs_output_active(const obs_output_t *output) {
+    return output->active.load(std::memory_order_acquire);
+}
+
+bool obs_output_start(obs_output_t *output) {
+    if (!output->started)
+        output->started = output->info.start(output->data);
+    return output->started;
+}
+
+bool obs_output_begin_data_capture(obs_output_t *output, uint32_t flags) {
+    std::lock_guard<std::mutex> guard(output->lock);
+    if (output->active.load())
+        return false;
+
+    // the previous end has finished but still needs joining
+    if (output->end_thread.joinable())
+        output->end_thread.join();
+
+    if (!flags)
+        flags = output->info.flags;
+
+    output->active = true;
+    output->feeding.store(true, std::memory_order_release);
+    if (flags & OBS_OUTPUT_VIDEO)
+        output->video_thread = std::thread(feed_video, output);
+    if (flags & OBS_OUTPUT_AUDIO)
+        output->audio_thread = std::thread(feed_audio, output);
+
+    if (config.capture_changed)
+        config.capture_changed(config.param, true, os_gettime_ns());
+    return true;
+}
+
+static void end_capture(obs_output_t *output) {
+    output->feeding.store(false, std::memory_order_release);
+    if (output->video_thread.joinable())
+        output->video_thread.join();
+    if (output->audio_thread.joinable())
+        output->audio_thread.join();
+
+    signal_emit(&output->signals, "deactivate");
+    if (config.capture_changed)
+        config.capture_changed(config.param, false, os_gettime_ns());
+
+    std::lock_guard<std::mutex> guard(output->lock);
+    output->ending = false;
+    output->active = false;
+}
+
+// Finishes on its own thread, like libobs
+void obs_output_end_data_capture(obs_output_t *output) {
+    std::lock_guard<std::mutex> guard(output->lock);
+    if (!output->active.load() || output->ending)
+        return;
+
+    if (output->end_thread.joinable())
+        output->end_thread.join();
+
+    output->ending = true;
+    output->end_thread = std::thread(end_capture, output);
+}
+
+void obs_output_force_stop(obs_output_t *output) {
+    if (output->started) {
+        output->started = false;
+        output->info.stop(output->data, 0);
+    }
+
+    // wait for an end_data_capture in flight
+    while (obs_output_active(output))
+        os_sleep_ms(1);
+
+    std::lock_guard<std::mutex> guard(output->lock);
+    if (output->end_thread.joinable())
+        output->end_thread.join();
+}
+
+void obs_output_release(obs_output_t *output) {
+    if (!output)
+        return;
+
+    obs_output_force_stop(output);
+    output->info.destroy(output->data);
+    delete output;
+}